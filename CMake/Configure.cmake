@@ -26,10 +26,22 @@ set_property(GLOBAL PROPERTY USE_FOLDERS ON)
 set(INSTALL_PATH  CACHE STRING "")
 set(COPY_ON_BUILD CACHE BOOL OFF)
 set(BUILD_SDL     CACHE BOOL OFF)
+set(NATIVE_SIMD   CACHE BOOL OFF)
 
 set(InspectionTools_INSTALL_PATH   ${INSTALL_PATH})
 set(InspectionTools_COPY_ON_BUILD   ${COPY_ON_BUILD})
 set(InspectionTools_BUILD_SDL       ${BUILD_SDL})
+set(InspectionTools_NATIVE_SIMD     ${NATIVE_SIMD})
+
+# Enables the SSSE3 and wider code paths. Without it only the
+# SSE2 paths that every x86-64 target supports are compiled.
+if (InspectionTools_NATIVE_SIMD)
+    if (MSVC)
+        add_compile_options(/arch:AVX2)
+    else()
+        add_compile_options(-march=native)
+    endif()
+endif()
 
 
 set(FreeImage_INCLUDE   ${InspectionTools_SOURCE_DIR}/Extern/FreeImage/Source)
@@ -57,6 +69,7 @@ macro(log_config)
     message(STATUS "Install path                : ${InspectionTools_INSTALL_PATH}")
     message(STATUS "Copy on build               : ${InspectionTools_COPY_ON_BUILD}")
     message(STATUS "Building SDL                : ${InspectionTools_BUILD_SDL}")
+    message(STATUS "Native SIMD                 : ${InspectionTools_NATIVE_SIMD}")
     message(STATUS "----------------------------")
     message(STATUS "")
     message(STATUS "-----------------------------------------------------------")
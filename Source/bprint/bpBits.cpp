@@ -0,0 +1,156 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "bpBits.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BIT_FRAME_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace BitFrame
+{
+    SK_INLINE SKuint64 loadBig(const SKuint8* src)
+    {
+        return (SKuint64)src[0] << 56 |
+               (SKuint64)src[1] << 48 |
+               (SKuint64)src[2] << 40 |
+               (SKuint64)src[3] << 32 |
+               (SKuint64)src[4] << 24 |
+               (SKuint64)src[5] << 16 |
+               (SKuint64)src[6] << 8 |
+               (SKuint64)src[7];
+    }
+
+    SK_INLINE SKuint64 loadLittle(const SKuint8* src)
+    {
+        return (SKuint64)src[7] << 56 |
+               (SKuint64)src[6] << 48 |
+               (SKuint64)src[5] << 40 |
+               (SKuint64)src[4] << 32 |
+               (SKuint64)src[3] << 24 |
+               (SKuint64)src[2] << 16 |
+               (SKuint64)src[1] << 8 |
+               (SKuint64)src[0];
+    }
+
+    class ReverseTable
+    {
+    public:
+        SKuint8 bits[256];
+
+        ReverseTable()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                SKuint8 r = 0;
+                for (int j = 0; j < 8; ++j)
+                {
+                    if (i & (1 << j))
+                        r |= (SKuint8)(0x80 >> j);
+                }
+                bits[i] = r;
+            }
+        }
+    };
+
+    static const ReverseTable Reverse;
+
+    // Gathers the low bit of each byte of w into one byte, the bit of
+    // the first byte in memory landing in bit 0.
+    SK_INLINE SKuint8 gatherLow(SKuint64 w)
+    {
+        return (SKuint8)(((w & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56);
+    }
+}  // namespace BitFrame
+
+SKsize BitFrame::readMsb(const SKuint8* data, SKsize bit, SKuint32 bits, SKsize count, SKuint64* dest)
+{
+    const SKuint32 drop = 64 - bits;
+
+    for (SKsize i = 0; i < count; ++i, bit += bits)
+    {
+        const SKuint8* src   = data + (bit >> 3);
+        const SKuint32 shift = bit & 7;
+
+        // the ninth byte holds the bits pushed out of the word by the shift
+        const SKuint64 w = loadBig(src) << shift | (SKuint64)(src[8] >> (8 - shift));
+        dest[i]          = w >> drop;
+    }
+    return bit;
+}
+
+SKsize BitFrame::readLsb(const SKuint8* data, SKsize bit, SKuint32 bits, SKsize count, SKuint64* dest)
+{
+    const SKuint64 mask = bits == 64 ? ~(SKuint64)0 : ((SKuint64)1 << bits) - 1;
+
+    for (SKsize i = 0; i < count; ++i, bit += bits)
+    {
+        const SKuint8* src   = data + (bit >> 3);
+        const SKuint32 shift = bit & 7;
+
+        // split the shift so that it stays below 64 when shift is zero
+        const SKuint64 w = loadLittle(src) >> shift | (SKuint64)src[8] << (63 - shift) << 1;
+        dest[i]          = w & mask;
+    }
+    return bit;
+}
+
+SKsize BitFrame::packedPlaneSize(SKsize len)
+{
+    return (len + 7) / 8;
+}
+
+SKsize BitFrame::packPlane(const SKuint8* src, SKsize len, SKuint32 plane, bool lsb, SKuint8* dest)
+{
+    SKsize i = 0, o = 0;
+
+#ifdef BIT_FRAME_SSE2
+    // The move mask takes the top bit of each byte, so the plane is
+    // shifted up to it. The 16 bit shift moves bits between bytes, but
+    // only the top bit of each byte is read.
+    const __m128i shift = _mm_cvtsi32_si128((int)(7 - plane));
+
+    for (; i + 16 <= len; i += 16, o += 2)
+    {
+        const __m128i in   = _mm_loadu_si128((const __m128i*)(src + i));
+        const int     mask = _mm_movemask_epi8(_mm_sll_epi16(in, shift));
+
+        dest[o]     = (SKuint8)mask;
+        dest[o + 1] = (SKuint8)(mask >> 8);
+    }
+#endif
+
+    for (; i + 8 <= len; i += 8)
+        dest[o++] = gatherLow(loadLittle(src + i) >> plane);
+
+    if (i < len)
+    {
+        SKuint8 tail[8] = {};
+        memcpy(tail, src + i, len - i);
+        dest[o++] = gatherLow(loadLittle(tail) >> plane);
+    }
+
+    if (!lsb)
+    {
+        for (i = 0; i < o; ++i)
+            dest[i] = Reverse.bits[dest[i]];
+    }
+    return o;
+}
@@ -0,0 +1,49 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _bpBits_h_
+#define _bpBits_h_
+
+#include "Utils/skString.h"
+
+// Word at a time kernels that read bytes as a bit sequence. The readers
+// load the eight bytes that hold a symbol in one word and shift it into
+// place, so data must be readable for 9 bytes past the last symbol.
+namespace BitFrame
+{
+    // Reads count symbols of bits [1, 64] wide, starting at bit offset
+    // bit. Bit 0 is the most significant bit of data[0] and each symbol
+    // is read most significant bit first. Returns the bit that follows the
+    // last symbol.
+    extern SKsize readMsb(const SKuint8* data, SKsize bit, SKuint32 bits, SKsize count, SKuint64* dest);
+
+    // As readMsb, but bit 0 is the least significant bit of data[0] and
+    // the first bit of each symbol is its least significant bit.
+    extern SKsize readLsb(const SKuint8* data, SKsize bit, SKuint32 bits, SKsize count, SKuint64* dest);
+
+    // Returns the size of dest needed to pack the planes of len bytes.
+    extern SKsize packedPlaneSize(SKsize len);
+
+    // Packs bit plane of each byte of src, eight bytes to one. The bit of
+    // src[0] is the most significant bit of dest[0], or the least when
+    // lsb is set. The last byte is padded with zero bits.
+    extern SKsize packPlane(const SKuint8* src, SKsize len, SKuint32 plane, bool lsb, SKuint8* dest);
+}  // namespace BitFrame
+
+#endif  //_bpBits_h_
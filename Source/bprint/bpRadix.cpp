@@ -0,0 +1,558 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "bpRadix.h"
+#include <cmath>
+#include "Utils/skMemoryUtils.h"
+
+typedef RadixConverter::Limbs Limbs;
+
+namespace
+{
+    // Below these sizes the quadratic methods are faster.
+    const SKsize KaratsubaLimbs  = 32;
+    const SKsize ReciprocalLimbs = 8;
+    const SKsize BasecaseLimbs   = 32;
+
+    SK_INLINE void trim(Limbs& a)
+    {
+        while (!a.empty() && a.back() == 0)
+            a.pop_back();
+    }
+
+    int compare(const SKuint32* a, SKsize an, const SKuint32* b, SKsize bn)
+    {
+        while (an > 0 && a[an - 1] == 0)
+            --an;
+        while (bn > 0 && b[bn - 1] == 0)
+            --bn;
+
+        if (an != bn)
+            return an < bn ? -1 : 1;
+
+        while (an-- > 0)
+        {
+            if (a[an] != b[an])
+                return a[an] < b[an] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    SK_INLINE int compare(const Limbs& a, const Limbs& b)
+    {
+        return compare(a.data(), a.size(), b.data(), b.size());
+    }
+
+    // a += b << (32 * shift), a must be large enough to hold the sum.
+    void addAt(SKuint32* a, SKsize an, const SKuint32* b, SKsize bn, SKsize shift)
+    {
+        SKuint64 carry = 0;
+        SKsize   i     = 0;
+        for (; i < bn; ++i)
+        {
+            carry += (SKuint64)a[shift + i] + b[i];
+            a[shift + i] = (SKuint32)carry;
+            carry >>= 32;
+        }
+
+        for (i += shift; carry && i < an; ++i)
+        {
+            carry += a[i];
+            a[i] = (SKuint32)carry;
+            carry >>= 32;
+        }
+    }
+
+    // a -= b, where a must not be less than b.
+    void subtract(SKuint32* a, SKsize an, const SKuint32* b, SKsize bn)
+    {
+        SKint64 borrow = 0;
+        SKsize  i      = 0;
+        for (; i < bn; ++i)
+        {
+            const SKint64 d = (SKint64)a[i] - b[i] - borrow;
+            borrow          = d < 0;
+            a[i]            = (SKuint32)d;
+        }
+
+        for (; borrow && i < an; ++i)
+        {
+            const SKint64 d = (SKint64)a[i] - borrow;
+            borrow          = d < 0;
+            a[i]            = (SKuint32)d;
+        }
+    }
+
+    SK_INLINE void subtract(Limbs& a, const Limbs& b)
+    {
+        subtract(a.data(), a.size(), b.data(), b.size());
+        trim(a);
+    }
+
+    void addWord(Limbs& a, SKint32 v)
+    {
+        const SKuint32 w = (SKuint32)(v < 0 ? -v : v);
+        if (v < 0)
+            subtract(a.data(), a.size(), &w, 1);
+        else
+        {
+            a.push_back(0);
+            addAt(a.data(), a.size(), &w, 1, 0);
+        }
+        trim(a);
+    }
+
+    // Drops the low n limbs.
+    SK_INLINE void shiftDown(Limbs& a, SKsize n)
+    {
+        a.erase(a.begin(), a.begin() + skMin(n, a.size()));
+    }
+
+    void multiplyBasic(SKuint32* r, const SKuint32* a, SKsize an, const SKuint32* b, SKsize bn)
+    {
+        for (SKsize i = 0; i < an; ++i)
+        {
+            const SKuint64 x     = a[i];
+            SKuint64       carry = 0;
+            for (SKsize j = 0; j < bn; ++j)
+            {
+                carry += x * b[j] + r[i + j];
+                r[i + j] = (SKuint32)carry;
+                carry >>= 32;
+            }
+            r[i + bn] = (SKuint32)carry;
+        }
+    }
+
+    // r = a * b, where r holds an + bn limbs.
+    void multiply(SKuint32* r, const SKuint32* a, SKsize an, const SKuint32* b, SKsize bn)
+    {
+        if (an < bn)
+        {
+            std::swap(a, b);
+            std::swap(an, bn);
+        }
+
+        skMemset(r, 0, (an + bn) * sizeof(SKuint32));
+        if (bn == 0)
+            return;
+
+        if (bn < KaratsubaLimbs)
+        {
+            multiplyBasic(r, a, an, b, bn);
+            return;
+        }
+
+        if (an >= 2 * bn)
+        {
+            // unbalanced, multiply b by slices of a of its own size
+            Limbs t(2 * bn);
+            for (SKsize i = 0; i < an; i += bn)
+            {
+                const SKsize n = skMin(bn, an - i);
+                multiply(t.data(), a + i, n, b, bn);
+                addAt(r, an + bn, t.data(), n + bn, i);
+            }
+            return;
+        }
+
+        // a = a1 m + a0, b = b1 m + b0, and the middle product is
+        // (a0 + a1)(b0 + b1) - a0 b0 - a1 b1
+        const SKsize    m  = (an + 1) / 2;
+        const SKuint32* a1 = a + m;
+        const SKuint32* b1 = b + m;
+        const SKsize    a1n = an - m, b1n = bn - m;
+
+        Limbs sa(a, a + m), sb(b, b + m);
+        sa.push_back(0);
+        sb.push_back(0);
+        addAt(sa.data(), m + 1, a1, a1n, 0);
+        addAt(sb.data(), m + 1, b1, b1n, 0);
+
+        Limbs mid(2 * m + 2);
+        multiply(mid.data(), sa.data(), m + 1, sb.data(), m + 1);
+
+        multiply(r, a, m, b, m);
+        multiply(r + 2 * m, a1, a1n, b1, b1n);
+
+        subtract(mid.data(), mid.size(), r, 2 * m);
+        subtract(mid.data(), mid.size(), r + 2 * m, a1n + b1n);
+
+        SKsize len = mid.size();
+        while (len > 0 && mid[len - 1] == 0)
+            --len;
+        addAt(r, an + bn, mid.data(), len, m);
+    }
+
+    Limbs product(const Limbs& a, const Limbs& b)
+    {
+        Limbs r(a.size() + b.size());
+        multiply(r.data(), a.data(), a.size(), b.data(), b.size());
+        trim(r);
+        return r;
+    }
+
+    Limbs powerOfLimb(SKsize n)
+    {
+        Limbs r(n + 1, 0);
+        r[n] = 1;
+        return r;
+    }
+
+    // Binary long division, used for the small reciprocals at
+    // the bottom of the Newton iteration.
+    Limbs divideBits(const Limbs& num, const Limbs& den)
+    {
+        Limbs q(num.size(), 0), r;
+        for (SKsize bit = num.size() * 32; bit-- > 0;)
+        {
+            SKuint32 carry = (num[bit / 32] >> (bit % 32)) & 1;
+            for (SKuint32& limb : r)
+            {
+                const SKuint32 top = limb >> 31;
+                limb               = limb << 1 | carry;
+                carry              = top;
+            }
+            if (carry)
+                r.push_back(carry);
+
+            if (compare(r, den) >= 0)
+            {
+                subtract(r, den);
+                q[bit / 32] |= 1u << (bit % 32);
+            }
+        }
+        trim(q);
+        return q;
+    }
+
+    // Returns at most floor(b^2n / p) and at least a few units less, for
+    // p of n limbs, where b is the limb base.
+    Limbs reciprocal(const Limbs& p)
+    {
+        const SKsize n   = p.size();
+        const Limbs  one = powerOfLimb(2 * n);
+
+        if (n <= ReciprocalLimbs)
+            return divideBits(one, p);
+
+        // The scaled reciprocal y of the top h limbs is correct to about
+        // h - 1 limbs, and one Newton step y += y (b^2n - p y) / b^2n
+        // doubles that. The extra limbs leave an error of a few units.
+        // Every rounding is downwards, so the result never passes the
+        // exact reciprocal, as Newton's method approaches it from below.
+        const SKsize h = n / 2 + 3;
+
+        Limbs y = reciprocal(Limbs(p.end() - h, p.end()));
+
+        // y is scaled by b^(n - h), which is left out of the products
+        Limbs e = product(p, y);
+        e.insert(e.begin(), n - h, 0);
+
+        // the low n - 2 limbs of the error change the step by less than one
+        const bool below = compare(e, one) <= 0;
+        if (below)
+        {
+            Limbs d = one;
+            subtract(d, e);
+            e.swap(d);
+        }
+        else
+            subtract(e, one);
+
+        shiftDown(e, n - 2);
+        Limbs t = product(y, e);
+        shiftDown(t, h + 2);
+
+        y.insert(y.begin(), n - h, 0);
+        if (below)
+        {
+            y.resize(skMax(y.size(), t.size()) + 1, 0);
+            addAt(y.data(), y.size(), t.data(), t.size(), 0);
+            trim(y);
+        }
+        else
+        {
+            subtract(y, t);
+            addWord(y, -2);
+        }
+        return y;
+    }
+
+    // Barrett division of a < p^2 by p, where mu is at most
+    // floor(b^2n / p) and at least a few units less.
+    void divide(const Limbs& a, const Limbs& p, const Limbs& mu, Limbs& q, Limbs& r)
+    {
+        r = a;
+        if (compare(a, p) < 0)
+        {
+            q.clear();
+            return;
+        }
+
+        const SKsize n = p.size();
+
+        q = Limbs(a.begin() + skMin(n - 1, a.size()), a.end());
+        q = product(q, mu);
+        shiftDown(q, n + 1);
+
+        // the estimate is never above the quotient and only a few units below
+        const Limbs qp = product(q, p);
+        subtract(r, qp);
+        while (compare(r, p) >= 0)
+        {
+            subtract(r, p);
+            addWord(q, 1);
+        }
+    }
+
+    // Division where the quotient is much shorter than p. Only the top
+    // limbs of both can change the quotient, so they are divided on their
+    // own and the estimate is corrected with the full remainder.
+    void divideShort(const Limbs& a, const Limbs& p, Limbs& q, Limbs& r)
+    {
+        if (compare(a, p) < 0)
+        {
+            q.clear();
+            r = a;
+            return;
+        }
+
+        const SKsize k = a.size() - p.size() + 3;
+        const SKsize s = p.size() - k;
+
+        const Limbs top(p.begin() + s, p.end());
+        divide(Limbs(a.begin() + s, a.end()), top, reciprocal(top), q, r);
+
+        Limbs qp = product(q, p);
+        while (compare(qp, a) > 0)
+        {
+            subtract(qp, p);
+            addWord(q, -1);
+        }
+
+        r = a;
+        subtract(r, qp);
+        while (compare(r, p) >= 0)
+        {
+            subtract(r, p);
+            addWord(q, 1);
+        }
+    }
+}  // namespace
+
+RadixConverter::RadixConverter(SKuint32 base) :
+    m_base(skClamp<SKuint32>(base, 2, 256)),
+    m_digits(1)
+{
+    // the most digits that fit in a limb
+    SKuint64 p = m_base;
+    while (p * m_base < ((SKuint64)1 << 32))
+    {
+        p *= m_base;
+        ++m_digits;
+    }
+
+    m_powers.resize(1);
+    m_powers[0].value.push_back((SKuint32)p);
+}
+
+const RadixConverter::Power& RadixConverter::getPower(SKsize level)
+{
+    while (m_powers.size() <= level)
+    {
+        Power power;
+        power.value = product(m_powers.back().value, m_powers.back().value);
+        m_powers.push_back(power);
+    }
+    return m_powers[level];
+}
+
+const Limbs& RadixConverter::getReciprocal(SKsize level)
+{
+    Power& power = m_powers[level];
+    if (power.reciprocal.empty())
+        power.reciprocal = reciprocal(power.value);
+    return power.reciprocal;
+}
+
+SKsize RadixConverter::encodedSize(SKsize len) const
+{
+    return (SKsize)ceil((double)len * 8.0 / log2((double)m_base)) + 1;
+}
+
+SKsize RadixConverter::decodedSize(SKsize len) const
+{
+    return len + 1;
+}
+
+void RadixConverter::toDigits(const Limbs& value, SKsize level, SKuint8* dest)
+{
+    const SKsize count = (SKsize)m_digits << level;
+
+    if (level == 0 || value.size() <= BasecaseLimbs)
+    {
+        // repeated division by the largest power that fits in a limb
+        const SKuint64 chunk = m_powers[0].value[0];
+
+        skMemset(dest, 0, count);
+
+        Limbs  v   = value;
+        SKsize end = count;
+        while (!v.empty())
+        {
+            SKuint64 rem = 0;
+            for (SKsize i = v.size(); i-- > 0;)
+            {
+                rem  = rem << 32 | v[i];
+                v[i] = (SKuint32)(rem / chunk);
+                rem %= chunk;
+            }
+            trim(v);
+
+            for (SKuint32 k = 0; k < m_digits; ++k)
+            {
+                dest[--end] = (SKuint8)(rem % m_base);
+                rem /= m_base;
+            }
+        }
+        return;
+    }
+
+    // the reciprocal of a power is only worth finding when
+    // the quotient is about as long as the power
+    const Limbs& p = getPower(level - 1).value;
+
+    Limbs q, r;
+    if (value.size() + 4 < 2 * p.size())
+        divideShort(value, p, q, r);
+    else
+        divide(value, p, getReciprocal(level - 1), q, r);
+
+    toDigits(q, level - 1, dest);
+    toDigits(r, level - 1, dest + count / 2);
+}
+
+void RadixConverter::fromDigits(Limbs& value, const SKuint8* src, SKsize len)
+{
+    value.clear();
+
+    if (len <= (SKsize)m_digits * BasecaseLimbs)
+    {
+        SKsize i = 0;
+        while (i < len)
+        {
+            const SKsize n = skMin<SKsize>(m_digits, len - i);
+
+            SKuint64 scale = 1, carry = 0;
+            for (SKsize k = 0; k < n; ++k)
+            {
+                carry = carry * m_base + src[i + k];
+                scale *= m_base;
+            }
+
+            // value = value * scale + digits
+            for (SKuint32& limb : value)
+            {
+                carry += (SKuint64)limb * scale;
+                limb = (SKuint32)carry;
+                carry >>= 32;
+            }
+            if (carry)
+                value.push_back((SKuint32)carry);
+            i += n;
+        }
+        return;
+    }
+
+    // split so that the low part is the largest power at or below half
+    SKsize level = 0;
+    while (((SKsize)m_digits << (level + 1)) < len)
+        ++level;
+
+    const SKsize low = (SKsize)m_digits << level;
+
+    Limbs high, rest;
+    fromDigits(high, src, len - low);
+    fromDigits(rest, src + len - low, low);
+
+    value = product(high, getPower(level).value);
+    value.resize(skMax(value.size(), rest.size()) + 1, 0);
+    addAt(value.data(), value.size(), rest.data(), rest.size(), 0);
+    trim(value);
+}
+
+SKsize RadixConverter::encode(const SKuint8* src, SKsize len, SKuint8* dest)
+{
+    SKsize zeros = 0;
+    while (zeros < len && src[zeros] == 0)
+        ++zeros;
+    skMemset(dest, 0, zeros);
+
+    Limbs value((len - zeros + 3) / 4, 0);
+    for (SKsize i = zeros; i < len; ++i)
+    {
+        const SKsize bit = (len - 1 - i) * 8;
+        value[bit / 32] |= (SKuint32)src[i] << (bit % 32);
+    }
+    trim(value);
+
+    if (value.empty())
+        return zeros;
+
+    SKsize level = 0;
+    while (compare(value, getPower(level).value) >= 0)
+        ++level;
+
+    const SKsize         count = (SKsize)m_digits << level;
+    std::vector<SKuint8> digits(count);
+    toDigits(value, level, digits.data());
+
+    SKsize first = 0;
+    while (digits[first] == 0)
+        ++first;
+
+    memcpy(dest + zeros, digits.data() + first, count - first);
+    return zeros + count - first;
+}
+
+SKsize RadixConverter::decode(const SKuint8* src, SKsize len, SKuint8* dest)
+{
+    SKsize zeros = 0;
+    while (zeros < len && src[zeros] == 0)
+        ++zeros;
+    skMemset(dest, 0, zeros);
+
+    Limbs value;
+    fromDigits(value, src + zeros, len - zeros);
+    trim(value);
+
+    SKsize size = zeros;
+    bool   lead = true;
+    for (SKsize i = value.size() * 4; i-- > 0;)
+    {
+        const SKuint8 b = (SKuint8)(value[i / 4] >> (i % 4 * 8));
+        if (lead && b == 0)
+            continue;
+
+        lead         = false;
+        dest[size++] = b;
+    }
+    return size;
+}
@@ -0,0 +1,79 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _bpRadix_h_
+#define _bpRadix_h_
+
+#include <vector>
+#include "Utils/skString.h"
+
+// Converts a whole byte string, read as one big endian number, to and
+// from its digits in an arbitrary base. Each leading zero byte is written
+// as a leading zero digit so that the conversion round trips, as base58
+// does.
+//
+// Digits are produced by splitting the number with the powers B^(k 2^i),
+// where B^k fits in a 32 bit limb, and the halves are converted on their
+// own. Products use Karatsuba multiplication and quotients use Barrett
+// reduction with reciprocals found by Newton iteration. The conversion
+// therefore costs O(M(n) log n) rather than the O(n^2) of repeated division.
+class RadixConverter
+{
+public:
+    typedef std::vector<SKuint32> Limbs;
+
+private:
+    struct Power
+    {
+        Limbs value;
+        Limbs reciprocal;
+    };
+
+    SKuint32           m_base;
+    SKuint32           m_digits;
+    std::vector<Power> m_powers;
+
+    const Power& getPower(SKsize level);
+
+    const Limbs& getReciprocal(SKsize level);
+
+    void toDigits(const Limbs& value, SKsize level, SKuint8* dest);
+
+    void fromDigits(Limbs& value, const SKuint8* src, SKsize len);
+
+public:
+    // The base must be in [2, 256].
+    explicit RadixConverter(SKuint32 base);
+
+    // Returns the size of dest needed to encode len bytes.
+    SKsize encodedSize(SKsize len) const;
+
+    // Returns the size of dest needed to decode len digits.
+    SKsize decodedSize(SKsize len) const;
+
+    // Writes the digits of src most significant first, each digit a value
+    // in [0, base). Returns the number of digits written.
+    SKsize encode(const SKuint8* src, SKsize len, SKuint8* dest);
+
+    // Converts digits in [0, base) back into bytes. Returns the number of
+    // bytes written.
+    SKsize decode(const SKuint8* src, SKsize len, SKuint8* dest);
+};
+
+#endif  //_bpRadix_h_
@@ -17,12 +17,21 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
+#include <cctype>
 #include <cmath>
+#include <cstring>
 #include "Utils/CommandLine/skCommandLineParser.h"
 #include "Utils/skFileStream.h"
 #include "Utils/skHexPrint.h"
 #include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
 #include "Utils/skString.h"
+#include "baseCodec.h"
+#include "bpBits.h"
+#include "bpRadix.h"
+#include "mappedFile.h"
+#include "orderedPipeline.h"
+#include "outputBuffer.h"
 
 using namespace skHexPrint;
 using namespace skCommandLine;
@@ -36,6 +45,14 @@ enum SwitchIds
     BP_RANGE,
     BP_ADD_WHITESPACE,
     BP_ADD_NEW_LINE,
+    BP_THREADS,
+    BP_NUMBER,
+    BP_DECODE,
+    BP_CODEC,
+    BP_BITS,
+    BP_BIT_OFFSET,
+    BP_LSB,
+    BP_PLANE,
     BP_MAX
 };
 
@@ -99,22 +116,186 @@ const Switch Switches[BP_MAX] = {
         true,
         1,
     },
+    {
+        BP_THREADS,
+        0,
+        "threads",
+        "Convert the range on more than one thread.\n"
+        "  - Arguments: number of threads [0-256], 0 uses one per core",
+        true,
+        1,
+    },
+    {
+        BP_NUMBER,
+        'n',
+        "number",
+        "Convert the whole range as one big endian number.\n"
+        "  - The base may be at most 256",
+        true,
+        0,
+    },
+    {
+        BP_DECODE,
+        'd',
+        "decode",
+        "Read symbols and write the bytes they encode.\n"
+        "  - Use the options the symbols were written with",
+        true,
+        0,
+    },
+    {
+        BP_CODEC,
+        'c',
+        "codec",
+        "Convert with a standard codec in place of --base.\n"
+        "  - Arguments: base16, base32, base32hex, base64, base64url, ascii85 or z85",
+        true,
+        1,
+    },
+    {
+        BP_BITS,
+        0,
+        "bits",
+        "Read the range as a bit sequence and convert symbols of N bits.\n"
+        "  - Arguments: [1-64]",
+        true,
+        1,
+    },
+    {
+        BP_BIT_OFFSET,
+        0,
+        "bit-offset",
+        "Skip the first N bits of the range with --bits.",
+        true,
+        1,
+    },
+    {
+        BP_LSB,
+        0,
+        "lsb",
+        "Read each byte from its least significant bit with --bits or --plane.",
+        true,
+        0,
+    },
+    {
+        BP_PLANE,
+        0,
+        "plane",
+        "Convert bit N of every byte, packed eight to a byte.\n"
+        "  - Arguments: [0-7]",
+        true,
+        1,
+    },
+};
+
+enum CodecIds
+{
+    CO_BASE16 = 0,
+    CO_BASE32,
+    CO_BASE32_HEX,
+    CO_BASE64,
+    CO_BASE64_URL,
+    CO_ASCII85,
+    CO_Z85,
+    CO_MAX
+};
+
+// Each group of block bytes is written as chars characters.
+struct Codec
+{
+    const char* name;
+    SKsize      block;
+    SKsize      chars;
+};
+
+const Codec Codecs[CO_MAX] = {
+    {"base16", 1, 2},
+    {"base32", 5, 8},
+    {"base32hex", 5, 8},
+    {"base64", 3, 4},
+    {"base64url", 3, 4},
+    {"ascii85", 4, 5},
+    {"z85", 4, 5},
 };
 
+const SKsize ChunkSize = 1 << 20;
+
+// The size of one rendered byte, which is at most eight
+// symbols and the white space before them.
+const SKsize CellSize = 16;
+
+// The size of a symbol wider than a byte, which is at most
+// 64 binary digits and the white space before them.
+const SKsize WideCellSize = 72;
+
+// The number of bytes converted per reservation in the output buffer.
+const SKsize BatchSize = 4096;
+
+// Marks a byte that is not a symbol in the inverse table. It is
+// above any digit, so it pushes a decoded value out of byte range.
+const SKuint32 InvalidSymbol = 0x10000;
+
+// The longest white space separated cell that is read when decoding.
+const SKsize MaxTokenSize = 16;
+
+// Decodes count cells of spaces followed by W symbols. The checks are
+// folded into one flag so the loop has no branches that depend on the
+// data, and it is unrolled for the width. Returns false when a cell is
+// not valid.
+template <int W>
+static bool decodeCells(const SKuint32* inverse,
+                        SKuint32        base,
+                        SKsize          spaces,
+                        const SKuint8*  src,
+                        SKsize          count,
+                        SKuint8*        dest)
+{
+    const SKsize stride = spaces + W;
+
+    SKuint64 bad = 0;
+    for (SKsize i = 0; i < count; ++i, src += stride)
+    {
+        for (SKsize j = 0; j < spaces; ++j)
+            bad |= src[j] ^ ' ';
+
+        SKuint64 v = 0;
+        for (int j = 0; j < W; ++j)
+            v = v * base + inverse[src[spaces + j]];
+
+        bad |= v >> 8;
+        dest[i] = (SKuint8)v;
+    }
+    return bad == 0;
+}
+
 class Application
 {
 private:
     skFileStream m_stream;
+    MappedFile   m_map;
     SKuint32     m_addressRange[2];
-    skString     m_tmp;
     skString     m_symbols;
     SKint32      m_base;
     SKint32      m_nl;
-    SKint32      m_total;
     SKint32      m_charsPerBase;
     SKint32      m_shift;
     bool         m_whitespace;
     bool         m_pad;
+    bool         m_number;
+    bool         m_decode;
+    SKuint32     m_codec;
+    SKuint32     m_bits;
+    SKsize       m_bitOffset;
+    bool         m_lsb;
+    SKuint32     m_plane;
+    SKsize       m_padWidth;
+    SKsize       m_cellWidth;
+    SKsize       m_cellSpaces;
+    SKuint32     m_inverse[256];
+    SKuint32     m_threads;
+    SKsize       m_begin;
+    char         m_cells[256][CellSize];
+    SKuint8      m_cellSize[256];
 
     void makeSymbolDefault()
     {
@@ -141,11 +322,22 @@ public:
         m_addressRange(),
         m_base(10),
         m_nl(0),
-        m_total(0),
         m_charsPerBase(0),
         m_shift(0),
         m_whitespace(false),
-        m_pad(false)
+        m_pad(false),
+        m_number(false),
+        m_decode(false),
+        m_codec(SK_NPOS32),
+        m_bits(0),
+        m_bitOffset(0),
+        m_lsb(false),
+        m_plane(SK_NPOS32),
+        m_padWidth(0),
+        m_cellWidth(0),
+        m_cellSpaces(0),
+        m_threads(1),
+        m_begin(0)
     {
         m_addressRange[0] = SK_NPOS32;
         m_addressRange[1] = SK_NPOS32;
@@ -171,6 +363,8 @@ public:
 
         m_whitespace = psr.isPresent(BP_ADD_WHITESPACE);
         m_pad        = psr.isPresent(BP_PAD_ZERO);
+        m_number     = psr.isPresent(BP_NUMBER);
+        m_decode     = psr.isPresent(BP_DECODE);
 
         if (psr.isPresent(BP_ADD_NEW_LINE))
             m_nl = psr.getValueInt(BP_ADD_NEW_LINE, 0, 0);
@@ -178,6 +372,9 @@ public:
         if (psr.isPresent(BP_SYMBOLS))
             m_symbols = psr.getValueString(BP_SYMBOLS, 0);
 
+        if (psr.isPresent(BP_THREADS))
+            m_threads = (SKuint32)skClamp(psr.getValueInt(BP_THREADS, 0, 1), 0, 256);
+
         if (psr.isPresent(BP_BASE))
         {
             m_base = psr.getValueInt(BP_BASE, 0, 10);
@@ -191,6 +388,45 @@ public:
             m_charsPerBase = charsPerBase(m_base);
         }
 
+        m_lsb = psr.isPresent(BP_LSB);
+
+        if (psr.isPresent(BP_BITS))
+        {
+            const SKint32 bits = psr.getValueInt(BP_BITS, 0, 8);
+            if (bits < 1 || bits > 64)
+            {
+                skLogd(LD_ERROR, "--bits must be in the range [1-64]\n");
+                return 1;
+            }
+            m_bits = (SKuint32)bits;
+
+            if (psr.isPresent(BP_BIT_OFFSET))
+                m_bitOffset = (SKsize)skMax<SKint64>(0, psr.getValueInt(BP_BIT_OFFSET, 0, 0));
+        }
+
+        if (psr.isPresent(BP_PLANE))
+        {
+            const SKint32 plane = psr.getValueInt(BP_PLANE, 0, 0);
+            if (plane < 0 || plane > 7)
+            {
+                skLogd(LD_ERROR, "--plane must be in the range [0-7]\n");
+                return 1;
+            }
+            m_plane = (SKuint32)plane;
+        }
+
+        if ((m_bits > 0 || m_plane != SK_NPOS32) && (m_number || m_decode || psr.isPresent(BP_CODEC)))
+        {
+            skLogd(LD_ERROR, "--bits and --plane cannot be used with --number, --decode or --codec\n");
+            return 1;
+        }
+
+        if (m_bits > 0 && m_plane != SK_NPOS32)
+        {
+            skLogd(LD_ERROR, "--bits cannot be used with --plane\n");
+            return 1;
+        }
+
         if (psr.isPresent(BP_SHIFT))
         {
             m_shift = psr.getValueInt(BP_SHIFT, 0, 0);
@@ -209,6 +445,58 @@ public:
             return 1;
         }
 
+        if (m_number && m_base > 256)
+        {
+            skLogd(LD_ERROR, "base must not be greater than 256 with --number\n");
+            return 1;
+        }
+
+        // symbols of --bits are padded to the digits of their widest value
+        m_padWidth = (SKsize)(m_bits > 0 ? digitsFor(m_bits) : charsPerBase(m_base));
+        if (m_bits > 0 && m_charsPerBase > 0)
+            m_charsPerBase = (SKint32)m_padWidth;
+
+        if (psr.isPresent(BP_CODEC))
+        {
+            const skString& name = psr.getValueString(BP_CODEC, 0);
+            for (m_codec = 0; m_codec < CO_MAX; ++m_codec)
+            {
+                if (strcmp(name.c_str(), Codecs[m_codec].name) == 0)
+                    break;
+            }
+
+            if (m_codec == CO_MAX)
+            {
+                skLogf(LD_ERROR, "Unknown codec '%s'\n", name.c_str());
+                return 1;
+            }
+
+            if (m_number)
+            {
+                skLogd(LD_ERROR, "--codec cannot be used with --number\n");
+                return 1;
+            }
+        }
+
+        if (m_decode && !m_number && m_codec == SK_NPOS32)
+        {
+            // --pad and the bases past a byte make every cell the same
+            // width, otherwise only the white space from --ws splits them
+            if (m_pad || m_base >= 256)
+            {
+                m_cellWidth  = m_pad ? charsPerBase(m_base) : 1;
+                m_cellSpaces = m_whitespace ? (SKsize)(1 + skMax<SKint32>(0, m_charsPerBase - (SKint32)m_cellWidth)) : 0;
+            }
+            else if (!m_whitespace)
+            {
+                skLogd(LD_ERROR, "decoding requires the cells to be split with --pad or --ws\n");
+                return 1;
+            }
+        }
+
+        if (m_decode && m_codec == SK_NPOS32 && !buildInverse())
+            return 1;
+
         using StringArray = Parser::StringArray;
         StringArray &args = psr.getArgList();
         if (args.empty())
@@ -223,9 +511,41 @@ public:
             skLogf(LD_ERROR, "Failed to open file %s\n", args[0].c_str());
             return 1;
         }
+
+        // The pipeline converts chunks out of order, so it reads from a
+        // mapping, and falls back to reading in order when that fails.
+        if (m_threads != 1 && !m_number && !m_decode && m_codec == SK_NPOS32 && m_bits == 0)
+            m_map.open(args[0].c_str());
+
+        buildCells();
         return 0;
     }
 
+    // Renders every byte value once, so converting a byte is a copy of its cell.
+    void buildCells()
+    {
+        skString tmp;
+        tmp.reserve(16);
+
+        skMemset(m_cells, 0, sizeof m_cells);
+        for (int i = 0; i < 256; ++i)
+            m_cellSize[i] = (SKuint8)printBase(m_cells[i], tmp, (SKuint8)i);
+    }
+
+    // Returns the number of digits in the largest value of bits.
+    int digitsFor(SKuint32 bits) const
+    {
+        SKuint64 v = bits == 64 ? ~(SKuint64)0 : ((SKuint64)1 << bits) - 1;
+
+        int n = 0;
+        do
+        {
+            v /= m_base;
+            ++n;
+        } while (v > 0);
+        return n;
+    }
+
     int charsPerBase(int base)
     {
         int ln = int(ceil(log(255.0) / log((double)(base))));
@@ -238,9 +558,6 @@ public:
 
     int print()
     {
-        SKuint8 buffer[1025];
-        m_tmp.reserve(16);
-
         SKsize n;
         SKsize a, r;
         n = m_stream.size();
@@ -250,39 +567,698 @@ public:
         if (m_addressRange[0] != SK_NPOS32)
             m_stream.seek(a, SEEK_SET);
         else
+        {
+            a = 0;
             r = n;
+        }
+
+        if (m_codec != SK_NPOS32)
+            return m_decode ? decodeCodec(r) : encodeCodec(r);
+        if (m_number)
+            return printNumber(r);
+        if (m_decode)
+            return decode(r);
+        if (m_bits > 0)
+            return printBits(a, r);
+
+        OutputBuffer out;
+        m_begin = a;
+
+        if (m_map.isOpen())
+        {
+            OrderedPipeline pipeline(m_threads, ChunkSize);
+            pipeline.run(a, skMin(a + r, n), convertChunk, this, out);
+        }
+        else
+        {
+            SKuint8* buffer = new SKuint8[ChunkSize];
+
+            SKsize br, tr = 0;
+            while (!m_stream.eof() && tr < r)
+            {
+                br = m_stream.read(buffer, skMin<SKsize>(ChunkSize, r - tr));
+                if (br == SK_NPOS32 || br == 0)
+                    break;
+
+                convertRange(out, buffer, br, tr);
+                tr += br;
+            }
+            delete[] buffer;
+        }
+
+        out.write("\n", 1);
+        return 0;
+    }
+
+    // Reads whole groups of the codec, so only the last read can be padded.
+    int encodeCodec(SKsize r)
+    {
+        const SKsize block = ChunkSize / Codecs[m_codec].block * Codecs[m_codec].block;
 
-        m_total = 0;
+        SKuint8* buffer = new SKuint8[block];
+        char*    text   = new char[encodedSize(block)];
 
-        SKuint64 address = 0;
-        SKsize   br, tr = 0, i = 0;
-        while (!m_stream.eof() && tr < r)
+        OutputBuffer out;
+        SKsize       br, len, column = 0, tr = 0;
+        while (tr < r)
         {
-            br = m_stream.read(buffer, skMin<SKsize>(1024, r));
-            if (br != SK_NPOS32 && br > 0)
+            len = 0;
+            while (len < block && tr + len < r && !m_stream.eof())
             {
-                buffer[br] = 0;
-                for (i = 0; i < br; ++i)
+                br = m_stream.read(buffer + len, skMin(block - len, r - tr - len));
+                if (br == SK_NPOS32 || br == 0)
+                    break;
+                len += br;
+            }
+
+            if (len == 0)
+                break;
+
+            writeLines(out, text, encodeBlock(buffer, len, text), column);
+            tr += len;
+        }
+
+        if (m_nl <= 0 || column != 0)
+            out.write("\n", 1);
+
+        delete[] text;
+        delete[] buffer;
+        return 0;
+    }
+
+    // Reads the range in chunks without white space and decodes
+    // the whole groups in each. The rest is kept for the next chunk.
+    int decodeCodec(SKsize r)
+    {
+        char*    text  = new char[ChunkSize + MaxTokenSize];
+        SKuint8* bytes = new SKuint8[decodedSize(ChunkSize + MaxTokenSize)];
+
+        OutputBuffer out;
+        SKsize       br, kept = 0, tr = 0;
+        int          rc = 0;
+
+        for (;;)
+        {
+            br = 0;
+            if (!m_stream.eof() && tr < r)
+            {
+                br = m_stream.read(text + kept, skMin<SKsize>(ChunkSize, r - tr));
+                if (br == SK_NPOS32)
+                    br = 0;
+            }
+
+            const bool   last = br == 0;
+            const SKsize len  = kept + BaseCodec::stripSpace(text + kept, br, text + kept);
+            const SKsize used = last ? len : splitGroups(text, len);
+            const SKsize n    = decodeBlock(text, used, bytes);
+
+            if (n == SK_NPOS)
+            {
+                skLogf(LD_ERROR, "Invalid %s data before offset %llu\n", Codecs[m_codec].name, (unsigned long long)(tr + br));
+                rc = 1;
+                break;
+            }
+
+            out.write((const char*)bytes, n);
+
+            kept = len - used;
+            memmove(text, text + used, kept);
+            tr += br;
+
+            if (last)
+                break;
+        }
+
+        delete[] bytes;
+        delete[] text;
+        return rc;
+    }
+
+    // Returns the length of the whole groups at the start of text.
+    SKsize splitGroups(const char* text, SKsize len) const
+    {
+        SKsize start = 0;
+
+        // an Ascii85 z is a group of its own
+        if (m_codec == CO_ASCII85)
+        {
+            for (SKsize i = len; i > 0; --i)
+            {
+                if (text[i - 1] == 'z')
                 {
-                    SKuint8 byte = buffer[i];
-                    printBase(byte);
+                    start = i;
+                    break;
+                }
+            }
+        }
+        return len - (len - start) % Codecs[m_codec].chars;
+    }
 
-                    if (m_nl > 0)
-                    {
-                        if (m_total++ % (m_nl) == (m_nl - 1))
-                            putchar('\n');
-                    }
+    SKsize encodedSize(SKsize len) const
+    {
+        switch (m_codec)
+        {
+        case CO_BASE16:
+            return BaseCodec::encodedHexSize(len);
+        case CO_BASE32:
+        case CO_BASE32_HEX:
+            return BaseCodec::encodedBase32Size(len);
+        case CO_BASE64:
+        case CO_BASE64_URL:
+            return BaseCodec::encodedBase64Size(len);
+        default:
+            return BaseCodec::encodedBase85Size(len);
+        }
+    }
+
+    SKsize decodedSize(SKsize len) const
+    {
+        switch (m_codec)
+        {
+        case CO_BASE16:
+            return BaseCodec::decodedHexSize(len);
+        case CO_BASE32:
+        case CO_BASE32_HEX:
+            return BaseCodec::decodedBase32Size(len);
+        case CO_BASE64:
+        case CO_BASE64_URL:
+            return BaseCodec::decodedBase64Size(len);
+        default:
+            return BaseCodec::decodedBase85Size(len);
+        }
+    }
+
+    SKsize encodeBlock(const SKuint8* src, SKsize len, char* dest) const
+    {
+        switch (m_codec)
+        {
+        case CO_BASE16:
+            return BaseCodec::encodeHex(src, len, dest);
+        case CO_BASE32:
+        case CO_BASE32_HEX:
+            return BaseCodec::encodeBase32(src, len, dest, m_codec == CO_BASE32_HEX);
+        case CO_BASE64:
+        case CO_BASE64_URL:
+            return BaseCodec::encodeBase64(src, len, dest, m_codec == CO_BASE64_URL);
+        default:
+            return BaseCodec::encodeBase85(src, len, dest, m_codec == CO_Z85);
+        }
+    }
+
+    SKsize decodeBlock(const char* src, SKsize len, SKuint8* dest) const
+    {
+        switch (m_codec)
+        {
+        case CO_BASE16:
+            return BaseCodec::decodeHex(src, len, dest);
+        case CO_BASE32:
+        case CO_BASE32_HEX:
+            return BaseCodec::decodeBase32(src, len, dest, m_codec == CO_BASE32_HEX);
+        case CO_BASE64:
+        case CO_BASE64_URL:
+            return BaseCodec::decodeBase64(src, len, dest, m_codec == CO_BASE64_URL);
+        default:
+            return BaseCodec::decodeBase85(src, len, dest, m_codec == CO_Z85);
+        }
+    }
+
+    // Writes text with a line break after every m_nl characters.
+    void writeLines(OutputBuffer& out, const char* text, SKsize len, SKsize& column) const
+    {
+        if (m_nl <= 0)
+        {
+            out.write(text, len);
+            return;
+        }
+
+        while (len > 0)
+        {
+            const SKsize n = skMin<SKsize>(len, m_nl - column);
+            out.write(text, n);
+
+            text += n;
+            len -= n;
+            column += n;
+            if (column == (SKsize)m_nl)
+            {
+                out.write("\n", 1);
+                column = 0;
+            }
+        }
+    }
+
+    // Reads the whole range, since every digit depends on every byte.
+    int printNumber(SKsize r)
+    {
+        SKuint8* data = new SKuint8[skMax<SKsize>(r, 1)];
+
+        SKsize br, len = 0;
+        while (!m_stream.eof() && len < r)
+        {
+            br = m_stream.read(data + len, r - len);
+            if (br == SK_NPOS32 || br == 0)
+                break;
+            len += br;
+        }
+
+        const int rc = m_decode ? decodeNumber(data, len) : encodeNumber(data, len);
+        delete[] data;
+        return rc;
+    }
+
+    int encodeNumber(const SKuint8* data, SKsize len)
+    {
+        RadixConverter radix(m_base);
+
+        SKuint8*     digits = new SKuint8[radix.encodedSize(len)];
+        const SKsize n      = radix.encode(data, len, digits);
+
+        OutputBuffer out;
+        SKsize       column = 0;
+        for (SKsize i = 0; i < n; i += BatchSize)
+        {
+            const SKsize e = skMin(n, i + BatchSize);
+
+            char* const start = out.reserve(2 * BatchSize);
+            char*       dest  = start;
+            for (SKsize j = i; j < e; ++j)
+            {
+                *dest++ = m_symbols.at((digits[j] + m_shift) % m_base);
+
+                if (m_nl > 0 && ++column == (SKsize)m_nl)
+                {
+                    *dest++ = '\n';
+                    column  = 0;
                 }
             }
+            out.commit((SKsize)(dest - start));
+        }
+
+        out.write("\n", 1);
+        delete[] digits;
+        return 0;
+    }
+
+    // Maps each symbol back to its digit. Symbols that repeat cannot be
+    // decoded, and the separators cannot be symbols when --ws splits cells.
+    bool buildInverse()
+    {
+        for (int i = 0; i < 256; ++i)
+            m_inverse[i] = InvalidSymbol;
+
+        for (SKint32 i = 0; i < m_base; ++i)
+        {
+            const SKuint8 ch = (SKuint8)m_symbols.at(i);
+            if (m_inverse[ch] != InvalidSymbol)
+            {
+                skLogf(LD_ERROR, "The symbol '%c' appears more than once\n", ch);
+                return false;
+            }
+
+            if (!m_number && (ch == '\n' || ch == '\r' || (m_cellWidth == 0 && isspace(ch))))
+            {
+                skLogf(LD_ERROR, "The symbol 0x%02X is also a separator\n", ch);
+                return false;
+            }
+            m_inverse[ch] = (SKuint32)((i - m_shift % m_base + m_base) % m_base);
+        }
+        return true;
+    }
+
+    int decodeNumber(const SKuint8* data, SKsize len)
+    {
+        SKuint8* digits = new SKuint8[skMax<SKsize>(len, 1)];
+        SKsize   n      = 0;
+
+        for (SKsize i = 0; i < len; ++i)
+        {
+            const SKuint32 d = m_inverse[data[i]];
+            if (d != InvalidSymbol)
+                digits[n++] = (SKuint8)d;
+            else if (!isspace(data[i]))
+            {
+                skLogf(LD_ERROR, "Invalid symbol 0x%02X at offset %llu\n", data[i], (unsigned long long)i);
+                delete[] digits;
+                return 1;
+            }
+        }
+
+        RadixConverter radix(m_base);
+
+        SKuint8*     bytes = new SKuint8[radix.decodedSize(n)];
+        const SKsize m     = radix.decode(digits, n, bytes);
+
+        OutputBuffer out;
+        out.write((const char*)bytes, m);
+
+        delete[] bytes;
+        delete[] digits;
+        return 0;
+    }
+
+    // Reads the range in chunks and rebuilds a byte from each cell. A cell
+    // that runs past the end of a chunk is kept for the next one.
+    int decode(SKsize r)
+    {
+        SKuint8* buffer = new SKuint8[ChunkSize + MaxTokenSize];
+
+        OutputBuffer out;
+        SKsize       br, kept = 0, used, tr = 0;
+        int          rc = 0;
+
+        for (;;)
+        {
+            br = 0;
+            if (!m_stream.eof() && tr < r)
+            {
+                br = m_stream.read(buffer + kept, skMin<SKsize>(ChunkSize, r - tr));
+                if (br == SK_NPOS32)
+                    br = 0;
+            }
+
+            const bool   last = br == 0;
+            const SKsize len  = kept + br;
+
+            if (m_cellWidth > 0)
+                used = decodeFixed(out, buffer, len, last, tr - kept);
+            else
+                used = decodeTokens(out, buffer, len, last, tr - kept);
+
+            if (used == SK_NPOS)
+            {
+                rc = 1;
+                break;
+            }
+
+            kept = len - used;
+            memmove(buffer, buffer + used, kept);
             tr += br;
+
+            if (last)
+                break;
         }
-        putchar('\n');
+
+        delete[] buffer;
+        return rc;
+    }
+
+    // Decodes the runs of fixed width cells between line breaks. Returns
+    // the number of bytes used, or SK_NPOS after reporting an error.
+    SKsize decodeFixed(OutputBuffer& out, const SKuint8* src, SKsize len, bool last, SKsize offset) const
+    {
+        const SKsize stride = m_cellSpaces + m_cellWidth;
+
+        SKsize p = 0;
+        while (p < len)
+        {
+            if (src[p] == '\n' || src[p] == '\r')
+            {
+                ++p;
+                continue;
+            }
+
+            const SKuint8* nl = (const SKuint8*)memchr(src + p, '\n', len - p);
+
+            SKsize e = nl ? (SKsize)(nl - src) : len;
+            if (nl && src[e - 1] == '\r')
+                --e;
+
+            SKsize cells = (e - p) / stride;
+            if (cells == 0)
+            {
+                if (!nl && !last)
+                    break;
+
+                skLogf(LD_ERROR, "Incomplete cell at offset %llu\n", (unsigned long long)(offset + p));
+                return SK_NPOS;
+            }
+
+            while (cells > 0)
+            {
+                const SKsize n = skMin(cells, BatchSize);
+
+                SKuint8* dest = (SKuint8*)out.reserve(n);
+                if (!decodeRun(src + p, n, dest))
+                {
+                    reportCell(src + p, n, offset + p);
+                    return SK_NPOS;
+                }
+
+                out.commit(n);
+                p += n * stride;
+                cells -= n;
+            }
+        }
+        return p;
+    }
+
+    bool decodeRun(const SKuint8* src, SKsize n, SKuint8* dest) const
+    {
+        switch (m_cellWidth)
+        {
+        case 1:
+            return decodeCells<1>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        case 2:
+            return decodeCells<2>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        case 3:
+            return decodeCells<3>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        case 4:
+            return decodeCells<4>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        case 5:
+            return decodeCells<5>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        case 6:
+            return decodeCells<6>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        case 7:
+            return decodeCells<7>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        default:
+            return decodeCells<8>(m_inverse, m_base, m_cellSpaces, src, n, dest);
+        }
+    }
+
+    // Finds the first cell in a run that failed to decode.
+    void reportCell(const SKuint8* src, SKsize n, SKsize offset) const
+    {
+        const SKsize stride = m_cellSpaces + m_cellWidth;
+
+        SKuint8 tmp;
+        for (SKsize i = 0; i < n; ++i, src += stride)
+        {
+            if (!decodeRun(src, 1, &tmp))
+            {
+                skLogf(LD_ERROR,
+                       "Invalid cell '%.*s' at offset %llu\n",
+                       (int)stride,
+                       (const char*)src,
+                       (unsigned long long)(offset + i * stride));
+                return;
+            }
+        }
+    }
+
+    // Decodes the cells between white space. Returns the number
+    // of bytes used, or SK_NPOS after reporting an error.
+    SKsize decodeTokens(OutputBuffer& out, const SKuint8* src, SKsize len, bool last, SKsize offset) const
+    {
+        SKsize p = 0;
+        while (p < len)
+        {
+            if (isspace(src[p]))
+            {
+                ++p;
+                continue;
+            }
+
+            SKsize e = p;
+            while (e < len && !isspace(src[e]))
+                ++e;
+
+            if (e == len && !last && e - p <= MaxTokenSize)
+                break;
+
+            SKuint64 v = 0;
+            for (SKsize i = p; i < e && v < 256; ++i)
+                v = v * m_base + m_inverse[src[i]];
+
+            if (v >= 256)
+            {
+                skLogf(LD_ERROR,
+                       "Invalid cell '%.*s' at offset %llu\n",
+                       (int)skMin<SKsize>(e - p, MaxTokenSize),
+                       (const char*)src + p,
+                       (unsigned long long)(offset + p));
+                return SK_NPOS;
+            }
+
+            *out.reserve(1) = (char)v;
+            out.commit(1);
+            p = e;
+        }
+        return p;
+    }
+
+    static void convertChunk(void* user, SKsize offset, SKsize len, OutputBuffer& out)
+    {
+        const Application* app = (const Application*)user;
+        app->convertRange(out, app->m_map.getData() + offset, len, offset - app->m_begin);
+    }
+
+    // Converts len bytes of the range, or the bit plane packed from them.
+    // Chunks start on a multiple of eight bytes, so their planes line up.
+    void convertRange(OutputBuffer& out, const SKuint8* data, SKsize len, SKsize index) const
+    {
+        if (m_plane == SK_NPOS32)
+        {
+            convert(out, data, len, index);
+            return;
+        }
+
+        SKuint8*     packed = new SKuint8[BitFrame::packedPlaneSize(len)];
+        const SKsize n      = BitFrame::packPlane(data, len, m_plane, m_lsb, packed);
+
+        convert(out, packed, n, index / 8);
+        delete[] packed;
+    }
+
+    // Reads the range as a bit sequence and converts each symbol of
+    // m_bits. Bits after the last whole symbol are ignored.
+    int printBits(SKsize a, SKsize r)
+    {
+        const SKsize skip = skMin(m_bitOffset >> 3, r);
+        m_stream.seek(a + skip, SEEK_SET);
+
+        // the readers load past the last symbol
+        SKuint8*  buffer  = new SKuint8[ChunkSize + 32];
+        SKuint64* symbols = new SKuint64[BatchSize];
+
+        OutputBuffer out;
+        SKsize       br, used, kept = 0, tr = skip, column = 0;
+        SKsize       bit = skip == (m_bitOffset >> 3) ? m_bitOffset & 7 : 0;
+
+        for (;;)
+        {
+            br = 0;
+            if (!m_stream.eof() && tr < r)
+            {
+                br = m_stream.read(buffer + kept, skMin<SKsize>(ChunkSize, r - tr));
+                if (br == SK_NPOS32)
+                    br = 0;
+            }
+
+            const SKsize len = kept + br;
+            skMemset(buffer + len, 0, 16);
+
+            bit  = convertBits(out, buffer, bit, len * 8, symbols, column);
+            used = skMin(bit >> 3, len);
+            kept = len - used;
+            memmove(buffer, buffer + used, kept);
+
+            bit -= used * 8;
+            tr += br;
+
+            if (br == 0)
+                break;
+        }
+
+        if (m_nl <= 0 || column != 0)
+            out.write("\n", 1);
+
+        delete[] symbols;
+        delete[] buffer;
         return 0;
     }
 
-    void printBase(SKuint8 inp)
+    // Converts the whole symbols from bit up to end, and returns
+    // the bit that follows the last one.
+    SKsize convertBits(OutputBuffer&  out,
+                       const SKuint8* data,
+                       SKsize         bit,
+                       SKsize         end,
+                       SKuint64*      symbols,
+                       SKsize&        column) const
+    {
+        skString tmp;
+        tmp.reserve(64);
+
+        while (bit + m_bits <= end)
+        {
+            const SKsize n = skMin<SKsize>((end - bit) / m_bits, BatchSize);
+
+            if (m_lsb)
+                bit = BitFrame::readLsb(data, bit, m_bits, n, symbols);
+            else
+                bit = BitFrame::readMsb(data, bit, m_bits, n, symbols);
+
+            char* const start = out.reserve(n * (WideCellSize + 1));
+            char*       dest  = start;
+
+            for (SKsize i = 0; i < n; ++i)
+            {
+                const SKuint64 v = symbols[i];
+                if (m_bits <= 8)
+                {
+                    memcpy(dest, m_cells[v], CellSize);
+                    dest += m_cellSize[v];
+                }
+                else
+                    dest += printBase(dest, tmp, v);
+
+                if (m_nl > 0 && ++column == (SKsize)m_nl)
+                {
+                    *dest++ = '\n';
+                    column  = 0;
+                }
+            }
+            out.commit((SKsize)(dest - start));
+        }
+        return bit;
+    }
+
+    // Converts len bytes, where index is the position of the
+    // first byte in the range so that --nl lines up across chunks.
+    void convert(OutputBuffer& out, const SKuint8* data, SKsize len, SKsize index) const
     {
-        m_tmp.resize(0);
+        SKsize column = m_nl > 0 ? index % m_nl : 0;
+
+        while (len > 0)
+        {
+            const SKsize n = skMin(len, BatchSize);
+
+            // whole cells are copied, only the rendered part is kept
+            char* const start = out.reserve(n * (CellSize + 1));
+            char*       dest  = start;
+
+            if (m_nl > 0)
+            {
+                for (SKsize i = 0; i < n; ++i)
+                {
+                    memcpy(dest, m_cells[data[i]], CellSize);
+                    dest += m_cellSize[data[i]];
+
+                    if (++column == (SKsize)m_nl)
+                    {
+                        *dest++ = '\n';
+                        column  = 0;
+                    }
+                }
+            }
+            else
+            {
+                for (SKsize i = 0; i < n; ++i)
+                {
+                    memcpy(dest, m_cells[data[i]], CellSize);
+                    dest += m_cellSize[data[i]];
+                }
+            }
+
+            out.commit((SKsize)(dest - start));
+            data += n;
+            len -= n;
+        }
+    }
+
+    SKsize printBase(char* dest, skString& tmp, SKuint64 inp) const
+    {
+        tmp.resize(0);
         int q, r;
 
         if (inp == 0)
@@ -293,14 +1269,13 @@ public:
                 r += m_shift;
                 r %= m_base;
             }
-            m_tmp.append(m_symbols.at(r));
+            tmp.append(m_symbols.at(r));
         }
         else
         {
             while (inp > 0)
             {
-                q = inp / m_base;
-                r = inp % m_base;
+                r = (int)(inp % m_base);
 
                 if (r < m_symbols.size())
                 {
@@ -309,16 +1284,15 @@ public:
                         r += m_shift;
                         r %= m_base;
                     }
-                    m_tmp.append(m_symbols.at(r));
+                    tmp.append(m_symbols.at(r));
                 }
-                inp = q;
+                inp /= m_base;
             }
         }
 
         if (m_pad)
         {
-            int cpb = charsPerBase(m_base);
-            while (m_tmp.size() < cpb)
+            while (tmp.size() < m_padWidth)
             {
                 r = 0;
                 if (m_shift > 0)
@@ -326,25 +1300,22 @@ public:
                     r += m_shift;
                     r %= m_base;
                 }
-                m_tmp.append(m_symbols.at(r));
+                tmp.append(m_symbols.at(r));
             }
         }
 
+        SKsize size = 0;
         if (m_whitespace)
         {
-            r = skMax<int>(0, m_charsPerBase - (int)m_tmp.size());
+            r = skMax<int>(0, m_charsPerBase - (int)tmp.size());
             for (q = 0; q < r; ++q)
-                print(' ');
-            print(' ');
+                dest[size++] = ' ';
+            dest[size++] = ' ';
         }
-        skString::ReverseIterator it = m_tmp.reverseIterator();
+        skString::ReverseIterator it = tmp.reverseIterator();
         while (it.hasMoreElements())
-            print(it.getNext());
-    }
-
-    void print(SKuint8 inp)
-    {
-        putchar(inp);
+            dest[size++] = it.getNext();
+        return size;
     }
 };
 
@@ -0,0 +1,732 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "baseCodec.h"
+#include "Utils/skMemoryUtils.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BASE_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define BASE_CODEC_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace BaseCodec
+{
+    const SKuint8 Invalid = 0xFF;
+
+    const char* const HexAlphabet       = "0123456789ABCDEF";
+    const char* const Base32Alphabet    = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+    const char* const Base32HexAlphabet = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+    const char* const Base64Alphabet    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const char* const Base64UrlAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    const char* const Z85Alphabet       = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.-:+=^!/*?&<>()[]{}@%$#";
+
+    class DecodeTables
+    {
+    public:
+        SKuint8 hex[256];
+        SKuint8 base64[256];
+        SKuint8 base64Url[256];
+        SKuint8 base32[256];
+        SKuint8 base32Hex[256];
+        SKuint8 ascii85[256];
+        SKuint8 z85[256];
+        SKuint8 compact[256][8];
+        SKuint8 compactSize[256];
+
+        DecodeTables()
+        {
+            int i, j;
+            skMemset(hex, Invalid, sizeof hex);
+            skMemset(base64, Invalid, sizeof base64);
+            skMemset(base64Url, Invalid, sizeof base64Url);
+            skMemset(base32, Invalid, sizeof base32);
+            skMemset(base32Hex, Invalid, sizeof base32Hex);
+            skMemset(ascii85, Invalid, sizeof ascii85);
+            skMemset(z85, Invalid, sizeof z85);
+
+            for (i = 0; i < 10; ++i)
+                hex['0' + i] = (SKuint8)i;
+            for (i = 0; i < 6; ++i)
+            {
+                hex['a' + i] = (SKuint8)(10 + i);
+                hex['A' + i] = (SKuint8)(10 + i);
+            }
+
+            for (i = 0; i < 64; ++i)
+            {
+                base64[(SKuint8)Base64Alphabet[i]]       = (SKuint8)i;
+                base64Url[(SKuint8)Base64UrlAlphabet[i]] = (SKuint8)i;
+            }
+
+            // base32 is case insensitive
+            for (i = 0; i < 32; ++i)
+            {
+                base32[(SKuint8)Base32Alphabet[i]]              = (SKuint8)i;
+                base32[(SKuint8)Base32Alphabet[i] | 0x20]       = (SKuint8)i;
+                base32Hex[(SKuint8)Base32HexAlphabet[i]]        = (SKuint8)i;
+                base32Hex[(SKuint8)Base32HexAlphabet[i] | 0x20] = (SKuint8)i;
+            }
+
+            for (i = 0; i < 85; ++i)
+            {
+                ascii85['!' + i]             = (SKuint8)i;
+                z85[(SKuint8)Z85Alphabet[i]] = (SKuint8)i;
+            }
+
+            // shuffles that move the lanes flagged in i to the front
+            for (i = 0; i < 256; ++i)
+            {
+                SKuint8 n = 0;
+                for (j = 0; j < 8; ++j)
+                {
+                    if (i & (1 << j))
+                        compact[i][n++] = (SKuint8)j;
+                }
+                compactSize[i] = n;
+                while (n < 8)
+                    compact[i][n++] = 0x80;
+            }
+        }
+    };
+
+    static const DecodeTables Tables;
+}  // namespace BaseCodec
+
+SKsize BaseCodec::decodedHexSize(SKsize len)
+{
+    return len / 2;
+}
+
+SKsize BaseCodec::decodedBase64Size(SKsize len)
+{
+    return (len + 3) / 4 * 3;
+}
+
+SKsize BaseCodec::decodeHex(const char* src, SKsize len, SKuint8* dest)
+{
+    if (len % 2 != 0)
+        return SK_NPOS;
+
+    SKsize i = 0, o = 0;
+
+#ifdef BASE_CODEC_SSE2
+    const __m128i ch0   = _mm_set1_epi8('0');
+    const __m128i cha   = _mm_set1_epi8('a');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i nine  = _mm_set1_epi8(9);
+    const __m128i five  = _mm_set1_epi8(5);
+    const __m128i ten   = _mm_set1_epi8(10);
+    const __m128i low   = _mm_set1_epi16(0x00FF);
+
+    for (; i + 16 <= len; i += 16, o += 8)
+    {
+        const __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+
+        // unsigned range checks, x <= n when max(x, n) == n
+        const __m128i d       = _mm_sub_epi8(in, ch0);
+        const __m128i a       = _mm_sub_epi8(_mm_or_si128(in, lower), cha);
+        const __m128i isDigit = _mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine);
+        const __m128i isAlpha = _mm_cmpeq_epi8(_mm_max_epu8(a, five), five);
+
+        if (_mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) != 0xFFFF)
+            return SK_NPOS;
+
+        const __m128i v = _mm_or_si128(_mm_and_si128(isDigit, d),
+                                       _mm_and_si128(isAlpha, _mm_add_epi8(a, ten)));
+
+        // v holds the high nibble in the even bytes, the low nibble in the odd
+        const __m128i hi = _mm_slli_epi16(_mm_and_si128(v, low), 4);
+        const __m128i lo = _mm_srli_epi16(v, 8);
+        _mm_storel_epi64((__m128i*)(dest + o), _mm_packus_epi16(_mm_or_si128(hi, lo), hi));
+    }
+#endif
+
+    for (; i < len; i += 2)
+    {
+        const SKuint8 hi = Tables.hex[(SKuint8)src[i]];
+        const SKuint8 lo = Tables.hex[(SKuint8)src[i + 1]];
+        if ((hi | lo) == Invalid)
+            return SK_NPOS;
+        dest[o++] = (SKuint8)(hi << 4 | lo);
+    }
+    return o;
+}
+
+namespace BaseCodec
+{
+    SK_INLINE bool isSeparator(char ch)
+    {
+        return ch == ' ' || ch == ',' || ch == '\n' || ch == '\r' || ch == '\t';
+    }
+
+    SK_INLINE bool isPrefix(const char* src, SKsize i, SKsize len)
+    {
+        return src[i] == '0' && i + 1 < len && (src[i + 1] | 0x20) == 'x';
+    }
+
+    // Returns false if a character is not part of the hex syntax.
+    SK_INLINE bool compactChar(const char* src, SKsize i, SKsize len, char*& dest)
+    {
+        const char ch = src[i];
+        if (Tables.hex[(SKuint8)ch] != Invalid)
+        {
+            if (!isPrefix(src, i, len))
+                *dest++ = ch;
+        }
+        else if (!isSeparator(ch) && (ch | 0x20) != 'x')
+            return false;
+        return true;
+    }
+}  // namespace BaseCodec
+
+SKsize BaseCodec::compactHex(const char* src, SKsize len, char* dest)
+{
+    char* const start = dest;
+
+    SKsize i = 0;
+
+#ifdef BASE_CODEC_SSSE3
+    const __m128i ch0   = _mm_set1_epi8('0');
+    const __m128i cha   = _mm_set1_epi8('a');
+    const __m128i chx   = _mm_set1_epi8('x');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i nine  = _mm_set1_epi8(9);
+    const __m128i five  = _mm_set1_epi8(5);
+
+    // The look ahead for 0x reads one byte past each block.
+    for (; i + 17 <= len; i += 16)
+    {
+        const __m128i in   = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i next = _mm_loadu_si128((const __m128i*)(src + i + 1));
+        const __m128i fold = _mm_or_si128(in, lower);
+
+        const __m128i isDigit = _mm_cmpeq_epi8(_mm_max_epu8(_mm_sub_epi8(in, ch0), nine), nine);
+        const __m128i isAlpha = _mm_cmpeq_epi8(_mm_max_epu8(_mm_sub_epi8(fold, cha), five), five);
+        const __m128i isHex   = _mm_or_si128(isDigit, isAlpha);
+        const __m128i isX     = _mm_cmpeq_epi8(fold, chx);
+
+        __m128i isSep = _mm_cmpeq_epi8(in, _mm_set1_epi8(' '));
+        isSep         = _mm_or_si128(isSep, _mm_cmpeq_epi8(in, _mm_set1_epi8(',')));
+        isSep         = _mm_or_si128(isSep, _mm_cmpeq_epi8(in, _mm_set1_epi8('\n')));
+        isSep         = _mm_or_si128(isSep, _mm_cmpeq_epi8(in, _mm_set1_epi8('\r')));
+        isSep         = _mm_or_si128(isSep, _mm_cmpeq_epi8(in, _mm_set1_epi8('\t')));
+
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(isHex, isSep), isX)) != 0xFFFF)
+        {
+            for (SKsize j = i; j < i + 16; ++j)
+            {
+                if (!compactChar(src, j, len, dest))
+                    return SK_NPOS;
+            }
+            continue;
+        }
+
+        // drop the 0 of each 0x prefix
+        const __m128i prefix = _mm_and_si128(_mm_cmpeq_epi8(in, ch0),
+                                             _mm_cmpeq_epi8(_mm_or_si128(next, lower), chx));
+
+        const int     keep = _mm_movemask_epi8(_mm_andnot_si128(prefix, isHex));
+        const int     lo   = keep & 0xFF;
+        const int     hi   = keep >> 8;
+        const __m128i slo  = _mm_loadl_epi64((const __m128i*)Tables.compact[lo]);
+        const __m128i shi  = _mm_loadl_epi64((const __m128i*)Tables.compact[hi]);
+
+        _mm_storel_epi64((__m128i*)dest, _mm_shuffle_epi8(in, slo));
+        dest += Tables.compactSize[lo];
+        _mm_storel_epi64((__m128i*)dest, _mm_shuffle_epi8(_mm_srli_si128(in, 8), shi));
+        dest += Tables.compactSize[hi];
+    }
+#endif
+
+    for (; i < len; ++i)
+    {
+        if (!compactChar(src, i, len, dest))
+            return SK_NPOS;
+    }
+    return (SKsize)(dest - start);
+}
+
+SKsize BaseCodec::decodeBase64(const char* src, SKsize len, SKuint8* dest, bool url)
+{
+    // Drop up to two padding characters from a complete quantum.
+    if (len % 4 == 0 && len > 0 && src[len - 1] == '=')
+    {
+        --len;
+        if (src[len - 1] == '=')
+            --len;
+    }
+
+    if (len % 4 == 1)
+        return SK_NPOS;
+
+    SKsize i = 0, o = 0;
+
+#ifdef BASE_CODEC_SSSE3
+    // Lookup scheme from aklomp/base64. The low and high nibble tables
+    // classify each byte and their intersection flags invalid input;
+    // the roll table holds the offset that maps each range to its value.
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F  = _mm_set1_epi8(0x2F);
+    const __m128i zero    = _mm_setzero_si128();
+    const __m128i pack0   = _mm_set1_epi32(0x01400140);
+    const __m128i pack1   = _mm_set1_epi32(0x00011000);
+    const __m128i order   = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    // Each step stores 16 bytes but only advances 12, keep enough
+    // input in reserve for the scalar tail to cover the overrun.
+    for (; i + 24 <= len; i += 16, o += 12)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+
+        if (url)
+        {
+            // map - and _ onto + and /, which are not part of the url alphabet
+            const __m128i isStd = _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('+')),
+                                               _mm_cmpeq_epi8(in, _mm_set1_epi8('/')));
+            if (_mm_movemask_epi8(isStd) != 0)
+                return SK_NPOS;
+
+            in = _mm_add_epi8(in, _mm_and_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('-')), _mm_set1_epi8('+' - '-')));
+            in = _mm_add_epi8(in, _mm_and_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('_')), _mm_set1_epi8('/' - '_')));
+        }
+
+        const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask2F);
+        const __m128i loNibbles = _mm_and_si128(in, mask2F);
+        const __m128i hi        = _mm_shuffle_epi8(lutHi, hiNibbles);
+        const __m128i lo        = _mm_shuffle_epi8(lutLo, loNibbles);
+
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), zero)) != 0)
+            return SK_NPOS;
+
+        const __m128i eq2F = _mm_cmpeq_epi8(in, mask2F);
+        in                 = _mm_add_epi8(in, _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles)));
+
+        // Merge the 6 bit values into 24 bit groups then put them in byte order
+        const __m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(in, pack0), pack1);
+        _mm_storeu_si128((__m128i*)(dest + o), _mm_shuffle_epi8(merged, order));
+    }
+#endif
+
+    const SKuint8* table = url ? Tables.base64Url : Tables.base64;
+    for (; i + 4 <= len; i += 4)
+    {
+        const SKuint8 a = table[(SKuint8)src[i]];
+        const SKuint8 b = table[(SKuint8)src[i + 1]];
+        const SKuint8 c = table[(SKuint8)src[i + 2]];
+        const SKuint8 d = table[(SKuint8)src[i + 3]];
+        if ((a | b | c | d) & 0xC0)
+            return SK_NPOS;
+
+        dest[o++] = (SKuint8)(a << 2 | b >> 4);
+        dest[o++] = (SKuint8)(b << 4 | c >> 2);
+        dest[o++] = (SKuint8)(c << 6 | d);
+    }
+
+    if (i < len)
+    {
+        const SKuint8 a = table[(SKuint8)src[i]];
+        const SKuint8 b = table[(SKuint8)src[i + 1]];
+        const SKuint8 c = i + 2 < len ? table[(SKuint8)src[i + 2]] : 0;
+        if ((a | b | c) & 0xC0)
+            return SK_NPOS;
+
+        dest[o++] = (SKuint8)(a << 2 | b >> 4);
+        if (i + 2 < len)
+            dest[o++] = (SKuint8)(b << 4 | c >> 2);
+    }
+    return o;
+}
+
+SKsize BaseCodec::stripSpace(const char* src, SKsize len, char* dest)
+{
+    char* const start = dest;
+
+    SKsize i = 0;
+
+#ifdef BASE_CODEC_SSSE3
+    for (; i + 16 <= len; i += 16)
+    {
+        const __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+
+        __m128i isSep = _mm_cmpeq_epi8(in, _mm_set1_epi8(' '));
+        isSep         = _mm_or_si128(isSep, _mm_cmpeq_epi8(in, _mm_set1_epi8('\n')));
+        isSep         = _mm_or_si128(isSep, _mm_cmpeq_epi8(in, _mm_set1_epi8('\r')));
+        isSep         = _mm_or_si128(isSep, _mm_cmpeq_epi8(in, _mm_set1_epi8('\t')));
+
+        const int sep = _mm_movemask_epi8(isSep);
+        if (sep == 0)
+        {
+            _mm_storeu_si128((__m128i*)dest, in);
+            dest += 16;
+            continue;
+        }
+
+        const int     keep = ~sep & 0xFFFF;
+        const int     lo   = keep & 0xFF;
+        const int     hi   = keep >> 8;
+        const __m128i slo  = _mm_loadl_epi64((const __m128i*)Tables.compact[lo]);
+        const __m128i shi  = _mm_loadl_epi64((const __m128i*)Tables.compact[hi]);
+
+        _mm_storel_epi64((__m128i*)dest, _mm_shuffle_epi8(in, slo));
+        dest += Tables.compactSize[lo];
+        _mm_storel_epi64((__m128i*)dest, _mm_shuffle_epi8(_mm_srli_si128(in, 8), shi));
+        dest += Tables.compactSize[hi];
+    }
+#endif
+
+    for (; i < len; ++i)
+    {
+        const char ch = src[i];
+        if (ch != ' ' && ch != '\n' && ch != '\r' && ch != '\t')
+            *dest++ = ch;
+    }
+    return (SKsize)(dest - start);
+}
+
+SKsize BaseCodec::encodedHexSize(SKsize len)
+{
+    return len * 2;
+}
+
+SKsize BaseCodec::encodedBase32Size(SKsize len)
+{
+    return (len + 4) / 5 * 8;
+}
+
+SKsize BaseCodec::encodedBase64Size(SKsize len)
+{
+    return (len + 2) / 3 * 4;
+}
+
+SKsize BaseCodec::encodedBase85Size(SKsize len)
+{
+    return (len + 3) / 4 * 5;
+}
+
+SKsize BaseCodec::decodedBase32Size(SKsize len)
+{
+    return (len + 7) / 8 * 5;
+}
+
+SKsize BaseCodec::decodedBase85Size(SKsize len)
+{
+    // a single z stands for four bytes
+    return len * 4;
+}
+
+SKsize BaseCodec::encodeHex(const SKuint8* src, SKsize len, char* dest)
+{
+    SKsize i = 0;
+
+#ifdef BASE_CODEC_SSSE3
+    const __m128i digits = _mm_loadu_si128((const __m128i*)HexAlphabet);
+    const __m128i low    = _mm_set1_epi8(0x0F);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        const __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(in, 4), low));
+        const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(in, low));
+
+        _mm_storeu_si128((__m128i*)(dest + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(dest + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+
+    for (; i < len; ++i)
+    {
+        dest[2 * i]     = HexAlphabet[src[i] >> 4];
+        dest[2 * i + 1] = HexAlphabet[src[i] & 0x0F];
+    }
+    return len * 2;
+}
+
+SKsize BaseCodec::encodeBase32(const SKuint8* src, SKsize len, char* dest, bool hex)
+{
+    const char* alphabet = hex ? Base32HexAlphabet : Base32Alphabet;
+
+    SKsize i = 0, o = 0;
+
+    // each group of five bytes is one 40 bit word
+    for (; i + 5 <= len; i += 5, o += 8)
+    {
+        const SKuint64 w = (SKuint64)src[i] << 32 |
+                           (SKuint64)src[i + 1] << 24 |
+                           (SKuint64)src[i + 2] << 16 |
+                           (SKuint64)src[i + 3] << 8 |
+                           (SKuint64)src[i + 4];
+
+        for (int j = 0; j < 8; ++j)
+            dest[o + j] = alphabet[(w >> (35 - 5 * j)) & 0x1F];
+    }
+
+    if (i < len)
+    {
+        const SKsize n = len - i;
+
+        SKuint64 w = 0;
+        for (SKsize j = 0; j < 5; ++j)
+            w = w << 8 | (j < n ? src[i + j] : 0);
+
+        // the bits of n bytes round up to a whole character
+        const SKsize chars = (n * 8 + 4) / 5;
+        for (SKsize j = 0; j < 8; ++j)
+            dest[o + j] = j < chars ? alphabet[(w >> (35 - 5 * j)) & 0x1F] : '=';
+        o += 8;
+    }
+    return o;
+}
+
+SKsize BaseCodec::decodeBase32(const char* src, SKsize len, SKuint8* dest, bool hex)
+{
+    const SKuint8* table = hex ? Tables.base32Hex : Tables.base32;
+
+    // Drop the padding of a complete group.
+    if (len % 8 == 0)
+    {
+        SKsize pad = 0;
+        while (pad < 6 && len > 0 && src[len - 1] == '=')
+        {
+            --len;
+            ++pad;
+        }
+    }
+
+    // the tail must hold a whole number of bytes
+    const SKsize tail = len % 8;
+    if (tail == 1 || tail == 3 || tail == 6)
+        return SK_NPOS;
+
+    SKsize i = 0, o = 0;
+    for (; i + 8 <= len; i += 8, o += 5)
+    {
+        SKuint64 w   = 0;
+        SKuint8  bad = 0;
+        for (int j = 0; j < 8; ++j)
+        {
+            const SKuint8 v = table[(SKuint8)src[i + j]];
+            bad |= v;
+            w = w << 5 | (v & 0x1F);
+        }
+
+        if (bad & 0xE0)
+            return SK_NPOS;
+
+        dest[o]     = (SKuint8)(w >> 32);
+        dest[o + 1] = (SKuint8)(w >> 24);
+        dest[o + 2] = (SKuint8)(w >> 16);
+        dest[o + 3] = (SKuint8)(w >> 8);
+        dest[o + 4] = (SKuint8)w;
+    }
+
+    if (tail > 0)
+    {
+        SKuint64 w = 0;
+        for (SKsize j = 0; j < 8; ++j)
+        {
+            const SKuint8 v = j < tail ? table[(SKuint8)src[i + j]] : 0;
+            if (v & 0xE0)
+                return SK_NPOS;
+            w = w << 5 | v;
+        }
+
+        const SKsize n = tail * 5 / 8;
+        for (SKsize j = 0; j < n; ++j)
+            dest[o++] = (SKuint8)(w >> (32 - 8 * j));
+    }
+    return o;
+}
+
+SKsize BaseCodec::encodeBase64(const SKuint8* src, SKsize len, char* dest, bool url)
+{
+    const char* alphabet = url ? Base64UrlAlphabet : Base64Alphabet;
+
+    SKsize i = 0, o = 0;
+
+#ifdef BASE_CODEC_SSSE3
+    // Scheme from Wojciech Mula. The shuffle spreads each 3 byte group
+    // over a 32 bit lane, the multiplies move the four 6 bit fields into
+    // their own bytes, and a 16 entry table holds the offset from each
+    // range of values to its first character.
+    const __m128i order  = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m128i mask0  = _mm_set1_epi32(0x0FC0FC00);
+    const __m128i mask1  = _mm_set1_epi32(0x003F03F0);
+    const __m128i mul0   = _mm_set1_epi32(0x04000040);
+    const __m128i mul1   = _mm_set1_epi32(0x01000010);
+    const __m128i n51    = _mm_set1_epi8(51);
+    const __m128i n26    = _mm_set1_epi8(26);
+    const __m128i n13    = _mm_set1_epi8(13);
+    const char    plus   = alphabet[62];
+    const char    slash  = alphabet[63];
+    const __m128i offset = _mm_setr_epi8('a' - 26,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         '0' - 52,
+                                         (char)(plus - 62),
+                                         (char)(slash - 63),
+                                         'A',
+                                         0,
+                                         0);
+
+    // Each step reads 16 bytes but only uses 12.
+    for (; i + 16 <= len; i += 12, o += 16)
+    {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i)), order);
+
+        const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, mask0), mul0);
+        const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, mask1), mul1);
+        const __m128i v  = _mm_or_si128(t0, t1);
+
+        __m128i range = _mm_subs_epu8(v, n51);
+        range         = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(n26, v), n13));
+
+        _mm_storeu_si128((__m128i*)(dest + o), _mm_add_epi8(v, _mm_shuffle_epi8(offset, range)));
+    }
+#endif
+
+    for (; i + 3 <= len; i += 3, o += 4)
+    {
+        const SKuint32 w = (SKuint32)src[i] << 16 | (SKuint32)src[i + 1] << 8 | src[i + 2];
+
+        dest[o]     = alphabet[w >> 18];
+        dest[o + 1] = alphabet[(w >> 12) & 0x3F];
+        dest[o + 2] = alphabet[(w >> 6) & 0x3F];
+        dest[o + 3] = alphabet[w & 0x3F];
+    }
+
+    if (i < len)
+    {
+        const bool     two = i + 1 < len;
+        const SKuint32 w   = (SKuint32)src[i] << 16 | (two ? (SKuint32)src[i + 1] << 8 : 0);
+
+        dest[o++] = alphabet[w >> 18];
+        dest[o++] = alphabet[(w >> 12) & 0x3F];
+        if (two)
+            dest[o++] = alphabet[(w >> 6) & 0x3F];
+        else if (!url)
+            dest[o++] = '=';
+        if (!url)
+            dest[o++] = '=';
+    }
+    return o;
+}
+
+SKsize BaseCodec::encodeBase85(const SKuint8* src, SKsize len, char* dest, bool z85)
+{
+    SKsize i = 0, o = 0;
+
+    char digits[85];
+    for (int j = 0; j < 85; ++j)
+        digits[j] = z85 ? Z85Alphabet[j] : (char)('!' + j);
+
+    for (; i + 4 <= len; i += 4)
+    {
+        SKuint32 w = (SKuint32)src[i] << 24 |
+                     (SKuint32)src[i + 1] << 16 |
+                     (SKuint32)src[i + 2] << 8 |
+                     src[i + 3];
+
+        if (w == 0 && !z85)
+        {
+            dest[o++] = 'z';
+            continue;
+        }
+
+        for (int j = 4; j >= 0; --j)
+        {
+            dest[o + j] = digits[w % 85];
+            w /= 85;
+        }
+        o += 5;
+    }
+
+    if (i < len)
+    {
+        const SKsize n = len - i;
+
+        SKuint32 w = 0;
+        for (SKsize j = 0; j < 4; ++j)
+            w = w << 8 | (j < n ? src[i + j] : 0);
+
+        char group[5];
+        for (int j = 4; j >= 0; --j)
+        {
+            group[j] = digits[w % 85];
+            w /= 85;
+        }
+
+        memcpy(dest + o, group, n + 1);
+        o += n + 1;
+    }
+    return o;
+}
+
+SKsize BaseCodec::decodeBase85(const char* src, SKsize len, SKuint8* dest, bool z85)
+{
+    const SKuint8* table = z85 ? Tables.z85 : Tables.ascii85;
+
+    SKsize i = 0, o = 0;
+    while (i < len)
+    {
+        if (src[i] == 'z' && !z85)
+        {
+            skMemset(dest + o, 0, 4);
+            o += 4;
+            ++i;
+            continue;
+        }
+
+        // A tail of n characters is padded with the last digit,
+        // which rounds the value up to the bytes it was made from.
+        const SKsize n = skMin<SKsize>(len - i, 5);
+        if (n == 1)
+            return SK_NPOS;
+
+        SKuint64 w = 0;
+        for (SKsize j = 0; j < 5; ++j)
+        {
+            const SKuint8 v = j < n ? table[(SKuint8)src[i + j]] : 84;
+            if (v == Invalid)
+                return SK_NPOS;
+            w = w * 85 + v;
+        }
+
+        if (w > 0xFFFFFFFF)
+            return SK_NPOS;
+
+        for (SKsize j = 0; j + 1 < n; ++j)
+            dest[o++] = (SKuint8)(w >> (24 - 8 * j));
+        i += n;
+    }
+    return o;
+}
@@ -0,0 +1,89 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _baseCodec_h_
+#define _baseCodec_h_
+
+#include "Utils/skString.h"
+
+// Byte to text codecs with SIMD kernels where the target supports them.
+// The decoders return the number of bytes written to dest or SK_NPOS when
+// the input holds a character outside of the alphabet.
+namespace BaseCodec
+{
+    // Returns the size of dest needed to decode len characters.
+    extern SKsize decodedHexSize(SKsize len);
+
+    extern SKsize decodedBase64Size(SKsize len);
+
+    // Decodes pairs of [0-9A-Fa-f], len must be even.
+    extern SKsize decodeHex(const char* src, SKsize len, SKuint8* dest);
+
+    // Copies the hex digits of src to dest, skipping white space, commas
+    // and 0x prefixes. dest must have room for len + 8 characters.
+    // Returns the number of digits written, or SK_NPOS if src holds
+    // any other character.
+    extern SKsize compactHex(const char* src, SKsize len, char* dest);
+
+    // Decodes [A-Za-z0-9+/] with optional = padding. An unpadded tail
+    // of two or three characters is accepted. The url alphabet uses -
+    // and _ in place of + and /.
+    extern SKsize decodeBase64(const char* src, SKsize len, SKuint8* dest, bool url = false);
+
+    // Copies src to dest without spaces, tabs and line breaks. dest may be
+    // src, otherwise it must have room for len + 8 characters. Returns the
+    // number of characters written.
+    extern SKsize stripSpace(const char* src, SKsize len, char* dest);
+
+    // The encoders return the number of characters written to dest, which
+    // must have room for the matching encoded size.
+    extern SKsize encodedHexSize(SKsize len);
+
+    extern SKsize encodedBase32Size(SKsize len);
+
+    extern SKsize encodedBase64Size(SKsize len);
+
+    extern SKsize encodedBase85Size(SKsize len);
+
+    extern SKsize decodedBase32Size(SKsize len);
+
+    extern SKsize decodedBase85Size(SKsize len);
+
+    // Writes two [0-9A-F] digits per byte.
+    extern SKsize encodeHex(const SKuint8* src, SKsize len, char* dest);
+
+    // Writes [A-Z2-7], or [0-9A-V] for the extended hex alphabet,
+    // padded with = to a multiple of eight characters.
+    extern SKsize encodeBase32(const SKuint8* src, SKsize len, char* dest, bool hex);
+
+    // Decodes either base32 alphabet with optional = padding.
+    extern SKsize decodeBase32(const char* src, SKsize len, SKuint8* dest, bool hex);
+
+    // Writes [A-Za-z0-9+/] padded with =, or the url alphabet without padding.
+    extern SKsize encodeBase64(const SKuint8* src, SKsize len, char* dest, bool url);
+
+    // Writes five characters per four bytes, in the Ascii85 alphabet
+    // [!-u] where a group of four zero bytes is written as z, or in the
+    // Z85 alphabet. A tail of n bytes is written as n + 1 characters.
+    extern SKsize encodeBase85(const SKuint8* src, SKsize len, char* dest, bool z85);
+
+    extern SKsize decodeBase85(const char* src, SKsize len, SKuint8* dest, bool z85);
+};  // namespace BaseCodec
+
+#endif  //_baseCodec_h_
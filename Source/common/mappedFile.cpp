@@ -0,0 +1,150 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "mappedFile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0),
+    m_descriptor(-1),
+    m_handle(nullptr),
+    m_mapping(nullptr)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    HANDLE fp = CreateFileA(path,
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+    if (fp == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fp, &size))
+    {
+        CloseHandle(fp);
+        return false;
+    }
+
+    m_handle = fp;
+    m_size   = (SKsize)size.QuadPart;
+    if (m_size == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(fp, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_data    = (const SKuint8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data == nullptr)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle((HANDLE)m_mapping);
+    if (m_handle)
+        CloseHandle((HANDLE)m_handle);
+
+    m_data    = nullptr;
+    m_size    = 0;
+    m_handle  = nullptr;
+    m_mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    const int fd = ::open(path, O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    m_descriptor = fd;
+    m_size       = (SKsize)st.st_size;
+    if (m_size == 0)
+        return true;
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    m_data = (const SKuint8*)data;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+        munmap((void*)m_data, m_size);
+    if (m_descriptor != -1)
+        ::close(m_descriptor);
+
+    m_data       = nullptr;
+    m_size       = 0;
+    m_descriptor = -1;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _mappedFile_h_
+#define _mappedFile_h_
+
+#include "Utils/skString.h"
+
+// Read only view of a whole file mapped into the address space.
+class MappedFile
+{
+private:
+    const SKuint8* m_data;
+    SKsize         m_size;
+    int            m_descriptor;
+    void*          m_handle;
+    void*          m_mapping;
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char* path);
+
+    void close();
+
+    SK_INLINE bool isOpen() const
+    {
+        return m_descriptor != -1 || m_handle != nullptr;
+    }
+
+    SK_INLINE const SKuint8* getData() const
+    {
+        return m_data;
+    }
+
+    SK_INLINE SKsize getSize() const
+    {
+        return m_size;
+    }
+};
+
+#endif  //_mappedFile_h_
@@ -0,0 +1,133 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "orderedPipeline.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "outputBuffer.h"
+
+const SKsize SlotCapacity = 1 << 16;
+const int    SpinCount    = 64;
+const int    YieldCount   = 1024;
+
+// A slot is free for sequence n when free holds n, and it holds the
+// output of sequence n when full holds n + 1. Each counter only has
+// one writer, so no locks are needed.
+struct OrderedPipeline::Slot
+{
+    std::atomic<SKsize> free;
+    std::atomic<SKsize> full;
+    OutputBuffer        out;
+
+    Slot() :
+        free(0),
+        full(0),
+        out(nullptr, SlotCapacity)
+    {
+    }
+};
+
+static void waitFor(const std::atomic<SKsize>& value, SKsize expected)
+{
+    int tries = 0;
+    while (value.load(std::memory_order_acquire) != expected)
+    {
+        if (++tries < SpinCount)
+            continue;
+        if (tries < YieldCount)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+OrderedPipeline::OrderedPipeline(SKuint32 threads, SKsize chunkSize) :
+    m_threads(threads > 0 ? threads : hardwareThreads()),
+    m_chunkSize(skMax<SKsize>(chunkSize, 1))
+{
+}
+
+SKuint32 OrderedPipeline::hardwareThreads()
+{
+    const unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? (SKuint32)n : 1;
+}
+
+void OrderedPipeline::run(SKsize begin, SKsize end, Task task, void* user, OutputBuffer& out)
+{
+    if (end <= begin)
+        return;
+
+    const SKsize count = (end - begin + m_chunkSize - 1) / m_chunkSize;
+
+    if (m_threads <= 1 || count == 1)
+    {
+        for (SKsize i = begin; i < end; i += m_chunkSize)
+            task(user, i, skMin(m_chunkSize, end - i), out);
+        return;
+    }
+
+    const SKuint32 threads = (SKuint32)skMin<SKsize>(m_threads, count);
+    const SKsize   slots   = (SKsize)threads * 2;
+
+    Slot* ring = new Slot[slots];
+    for (SKsize i = 0; i < slots; ++i)
+        ring[i].free.store(i, std::memory_order_relaxed);
+
+    std::atomic<SKsize> next(0);
+
+    const auto worker = [&]() {
+        for (;;)
+        {
+            const SKsize seq = next.fetch_add(1, std::memory_order_relaxed);
+            if (seq >= count)
+                break;
+
+            Slot& slot = ring[seq % slots];
+            waitFor(slot.free, seq);
+
+            const SKsize offset = begin + seq * m_chunkSize;
+            task(user, offset, skMin(m_chunkSize, end - offset), slot.out);
+
+            slot.full.store(seq + 1, std::memory_order_release);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (SKuint32 i = 0; i < threads; ++i)
+        pool.emplace_back(worker);
+
+    for (SKsize seq = 0; seq < count; ++seq)
+    {
+        Slot& slot = ring[seq % slots];
+        waitFor(slot.full, seq + 1);
+
+        out.write(slot.out.getData(), slot.out.getSize());
+        slot.out.clear();
+
+        slot.free.store(seq + slots, std::memory_order_release);
+    }
+
+    for (std::thread& thread : pool)
+        thread.join();
+    delete[] ring;
+}
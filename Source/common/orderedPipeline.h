@@ -0,0 +1,61 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _orderedPipeline_h_
+#define _orderedPipeline_h_
+
+#include "Utils/skString.h"
+
+class OutputBuffer;
+
+// Splits a range into fixed size chunks that are formatted by a set of
+// worker threads, each into the buffer of a slot in a ring. The calling
+// thread writes the slots in chunk order, so the output is the same as
+// formatting the chunks one after the other.
+class OrderedPipeline
+{
+public:
+    // Formats the chunk [offset, offset + len) into out. It is called
+    // from several threads at once.
+    typedef void (*Task)(void* user, SKsize offset, SKsize len, OutputBuffer& out);
+
+private:
+    struct Slot;
+
+    SKuint32 m_threads;
+    SKsize   m_chunkSize;
+
+public:
+    // A thread count of zero uses one thread per core.
+    OrderedPipeline(SKuint32 threads, SKsize chunkSize);
+
+    // Calls task for each chunk in [begin, end) and writes the results
+    // to out in order. With a single thread the chunks are formatted
+    // directly into out.
+    void run(SKsize begin, SKsize end, Task task, void* user, OutputBuffer& out);
+
+    SK_INLINE SKuint32 getThreads() const
+    {
+        return m_threads;
+    }
+
+    static SKuint32 hardwareThreads();
+};
+
+#endif  //_orderedPipeline_h_
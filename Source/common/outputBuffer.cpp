@@ -0,0 +1,99 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "outputBuffer.h"
+#include <cstdarg>
+#include "Utils/skMemoryUtils.h"
+
+OutputBuffer::OutputBuffer(FILE* fp, SKsize capacity) :
+    m_fp(fp),
+    m_data(new char[capacity]),
+    m_size(0),
+    m_capacity(capacity)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    flush();
+    delete[] m_data;
+}
+
+void OutputBuffer::flush()
+{
+    if (!m_fp)
+        return;
+
+    if (m_size > 0)
+    {
+        fwrite(m_data, 1, m_size, m_fp);
+        m_size = 0;
+    }
+    fflush(m_fp);
+}
+
+void OutputBuffer::grow(SKsize len)
+{
+    SKsize capacity = skMax<SKsize>(m_capacity * 2, 64);
+    while (capacity < m_size + len)
+        capacity *= 2;
+
+    char* data = new char[capacity];
+    memcpy(data, m_data, m_size);
+
+    delete[] m_data;
+    m_data     = data;
+    m_capacity = capacity;
+}
+
+void OutputBuffer::write(const char* str, SKsize len)
+{
+    while (len > 0)
+    {
+        const SKsize n = skMin(len, m_capacity);
+
+        memcpy(reserve(n), str, n);
+        commit(n);
+
+        str += n;
+        len -= n;
+    }
+}
+
+void OutputBuffer::print(const char* fmt, ...)
+{
+    char    buf[1024];
+    va_list lst, copy;
+    va_start(lst, fmt);
+    va_copy(copy, lst);
+    const int len = vsnprintf(buf, sizeof buf, fmt, lst);
+    va_end(lst);
+
+    if (len > 0 && (SKsize)len < sizeof buf)
+        write(buf, (SKsize)len);
+    else if (len > 0)
+    {
+        // longer text is formatted again into a buffer that holds all of it
+        char* text = new char[(SKsize)len + 1];
+        vsnprintf(text, (SKsize)len + 1, fmt, copy);
+        write(text, (SKsize)len);
+        delete[] text;
+    }
+    va_end(copy);
+}
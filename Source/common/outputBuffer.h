@@ -0,0 +1,90 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _outputBuffer_h_
+#define _outputBuffer_h_
+
+#include <cstdio>
+#include "Utils/skString.h"
+
+// Large write buffer in front of a FILE. Writers reserve space, format
+// directly into it and then commit the number of bytes written.
+// Without a FILE the buffer grows instead, and the bytes are kept
+// until they are taken with getData and clear.
+class OutputBuffer
+{
+private:
+    FILE*  m_fp;
+    char*  m_data;
+    SKsize m_size;
+    SKsize m_capacity;
+
+    void grow(SKsize len);
+
+public:
+    explicit OutputBuffer(FILE* fp = stdout, SKsize capacity = 1 << 20);
+    ~OutputBuffer();
+
+    void flush();
+
+    // Returns space for at least len bytes. When writing to a FILE,
+    // len must not exceed the capacity of the buffer.
+    SK_INLINE char* reserve(SKsize len)
+    {
+        if (m_size + len > m_capacity)
+        {
+            if (m_fp)
+                flush();
+            else
+                grow(len);
+        }
+        return m_data + m_size;
+    }
+
+    SK_INLINE void commit(SKsize len)
+    {
+        m_size += len;
+    }
+
+    void write(const char* str, SKsize len);
+
+    void print(const char* fmt, ...);
+
+    SK_INLINE SKsize getCapacity() const
+    {
+        return m_capacity;
+    }
+
+    SK_INLINE const char* getData() const
+    {
+        return m_data;
+    }
+
+    SK_INLINE SKsize getSize() const
+    {
+        return m_size;
+    }
+
+    SK_INLINE void clear()
+    {
+        m_size = 0;
+    }
+};
+
+#endif  //_outputBuffer_h_
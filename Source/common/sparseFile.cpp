@@ -0,0 +1,87 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "sparseFile.h"
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+#define SPARSE_FILE_SEEK
+#endif
+
+SparseFile::SparseFile() :
+    m_descriptor(-1)
+{
+}
+
+SparseFile::~SparseFile()
+{
+    close();
+}
+
+bool SparseFile::open(const char* path)
+{
+    close();
+#ifdef SPARSE_FILE_SEEK
+    m_descriptor = ::open(path, O_RDONLY);
+#else
+    (void)path;
+#endif
+    return m_descriptor != -1;
+}
+
+void SparseFile::close()
+{
+#ifdef SPARSE_FILE_SEEK
+    if (m_descriptor != -1)
+        ::close(m_descriptor);
+#endif
+    m_descriptor = -1;
+}
+
+SKsize SparseFile::nextData(SKsize pos, SKsize end) const
+{
+#ifdef SPARSE_FILE_SEEK
+    if (m_descriptor != -1)
+    {
+        // ENXIO means that there is no data past pos
+        const off_t rc = lseek(m_descriptor, (off_t)pos, SEEK_DATA);
+        if (rc < 0)
+            return errno == ENXIO ? end : pos;
+        return skMin<SKsize>((SKsize)rc, end);
+    }
+#endif
+    return pos;
+}
+
+SKsize SparseFile::nextHole(SKsize pos, SKsize end) const
+{
+#ifdef SPARSE_FILE_SEEK
+    if (m_descriptor != -1)
+    {
+        const off_t rc = lseek(m_descriptor, (off_t)pos, SEEK_HOLE);
+        if (rc >= 0)
+            return skMin<SKsize>((SKsize)rc, end);
+    }
+#endif
+    return end;
+}
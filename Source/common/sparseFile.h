@@ -0,0 +1,50 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _sparseFile_h_
+#define _sparseFile_h_
+
+#include "Utils/skString.h"
+
+// Queries the holes of a sparse file with SEEK_DATA and SEEK_HOLE.
+// Where the platform or the file system does not report holes, the
+// whole file reads as data.
+class SparseFile
+{
+private:
+    int m_descriptor;
+
+public:
+    SparseFile();
+    ~SparseFile();
+
+    bool open(const char* path);
+
+    void close();
+
+    // Returns the first address at or after pos that holds data,
+    // or end if the rest of the file is a hole.
+    SKsize nextData(SKsize pos, SKsize end) const;
+
+    // Returns the first address at or after pos that starts a hole,
+    // or end if there is none before it.
+    SKsize nextHole(SKsize pos, SKsize end) const;
+};
+
+#endif  //_sparseFile_h_
@@ -17,15 +17,16 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
-#include "Image/skImage.h"
+#include <cstring>
 #include "Math/skMath.h"
 #include "Utils/CommandLine/skCommandLineParser.h"
-#include "Utils/skFileStream.h"
 #include "Utils/skHexPrint.h"
 #include "Utils/skLogger.h"
 #include "Utils/skPlatformHeaders.h"
 #include "Utils/skString.h"
 #include "fimgApp.h"
+#include "fimgTilePyramid.h"
+#include "mappedFile.h"
 
 using namespace skHexPrint;
 using namespace skCommandLine;
@@ -35,6 +36,8 @@ enum SwitchIds
     FI_RANGE = 0,
     FI_MAX,
     FI_GRAPH,
+    FI_CACHE,
+    FI_LOD,
     FI_MAX_ENUM
 };
 
@@ -69,16 +72,43 @@ const Switch Switches[FI_MAX_ENUM] = {
         "    - Height [100 - 4320]\n",
         true,
         2,
+    },
+    {
+        FI_CACHE,
+        'c',
+        "cache",
+        "Specify the texture memory budget in megabytes.\n"
+        "  - Arguments: [16 - 4096]\n",
+        true,
+        1,
+    },
+    {
+        FI_LOD,
+        'l',
+        "lod",
+        "Specify the summary drawn when zoomed out.\n"
+        "  - Arguments: [mean, min, max, entropy]\n",
+        true,
+        1,
     }};
 
+const SKint32 DefaultCacheSize = 256;
+
+const char* LodNames[TilePyramid::CH_MAX_ENUM] = {
+    "mean",
+    "min",
+    "max",
+    "entropy",
+};
+
 class Application : public FimgApplication
 {
 private:
-    skFileStream m_stream;
-    SKuint32     m_addressRange[2];
-    SKint32      m_width;
-    SKint32      m_height;
-    bool         m_window;
+    MappedFile m_map;
+    SKuint32   m_addressRange[2];
+    SKint32    m_width;
+    SKint32    m_height;
+    bool       m_window;
 
 public:
     Application() :
@@ -87,14 +117,12 @@ public:
         m_height(600),
         m_window(false)
     {
-        skImage::initialize();
         m_addressRange[0] = SK_NPOS32;
         m_addressRange[1] = SK_NPOS32;
     }
 
     virtual ~Application()
     {
-        skImage::finalize();
     }
 
     int parse(int argc, char** argv)
@@ -110,11 +138,30 @@ public:
         }
 
         SKint32 mVal = psr.getValueInt(FI_MAX, 0, 32);
-        if (!SK_HASHTABLE_IS_POW2(mVal))
+        if ((mVal & (mVal - 1)) != 0)
             mVal = skMath::pow2(mVal);
 
         m_max = skClamp<SKint32>(mVal, 32, 256);
 
+        const SKint32 cache = psr.getValueInt(FI_CACHE, 0, DefaultCacheSize);
+        m_cacheSize         = (SKsize)skClamp(cache, 16, 4096) << 20;
+
+        if (psr.isPresent(FI_LOD))
+        {
+            const skString& name = psr.getValueString(FI_LOD, 0);
+            for (m_lod = 0; m_lod < TilePyramid::CH_MAX_ENUM; ++m_lod)
+            {
+                if (strcmp(name.c_str(), LodNames[m_lod]) == 0)
+                    break;
+            }
+
+            if (m_lod == TilePyramid::CH_MAX_ENUM)
+            {
+                skLogf(LD_ERROR, "Unknown summary '%s'\n", name.c_str());
+                return 1;
+            }
+        }
+
         if (psr.isPresent(FI_GRAPH))
         {
             m_window = true;
@@ -133,8 +180,8 @@ public:
             return 1;
         }
 
-        m_stream.open(args[0].c_str(), skStream::READ);
-        if (!m_stream.isOpen())
+        // Tiles are read straight from the mapping as they come into view.
+        if (!m_map.open(args[0].c_str()))
         {
             skLogf(LD_ERROR, "Failed to open file %s\n", args[0].c_str());
             return 1;
@@ -143,56 +190,22 @@ public:
         return 0;
     }
 
-    void buildImage()
+    void setRange()
     {
-        SKuint8 buffer[1025];
-
-        const SKsize n = m_stream.size();
+        const SKsize n = m_map.getSize();
         const SKsize a = skClamp<SKsize>(m_addressRange[0], 0, n);
-        SKsize       r = skClamp<SKsize>(m_addressRange[1], 0, n);
+        SKsize       r = skClamp<SKsize>(m_addressRange[1], 0, n - a);
 
-        if (m_addressRange[0] != SK_NPOS32)
-            m_stream.seek(a, SEEK_SET);
-        else
+        if (m_addressRange[0] == SK_NPOS32)
             r = n;
 
-        SKint32  x = 0, y = 0;
-        skImage* working = new skImage(m_max, m_max, skPixelFormat::SK_RGBA);
-        m_images.push_back(working);
-
-        SKsize tr = 0;
-        while (!m_stream.eof() && tr < r)
-        {
-            const SKsize br = m_stream.read(buffer, skMin<SKsize>(1024, r));
-            if (br != SK_NPOS32 && br > 0)
-            {
-                buffer[br] = 0;
-
-                for (SKsize i = 0; i < br; ++i)
-                {
-                    const auto ch = static_cast<SKubyte>(buffer[i]);
-
-                    working->setPixel(x, m_max - 1 - y, skPixel(ch, ch, ch, 128));
-
-                    if (++x % m_max == 0)
-                    {
-                        if (++y % m_max == 0)
-                        {
-                            working = new skImage(m_max, m_max, skPixelFormat::SK_RGBA);
-                            m_images.push_back(working);
-                            y = 0;
-                        }
-                        x = 0;
-                    }
-                }
-            }
-            tr += br;
-        }
+        m_data = m_map.getData() + (m_addressRange[0] != SK_NPOS32 ? a : 0);
+        m_size = r;
     }
 
     int print()
     {
-        buildImage();
+        setRange();
         run(m_width, m_height);
         return 0;
     }
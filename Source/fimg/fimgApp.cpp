@@ -31,6 +31,9 @@
 #define SDL_MAIN_HANDLED
 #include "SDL.h"
 #include "fimgPixelMap.h"
+#include "fimgTileBuilder.h"
+#include "fimgTileCache.h"
+#include "fimgTilePyramid.h"
 
 const skColor  Clear            = skColor(0x555555FF);
 const skColor  Background       = skColor(0x282828FF);
@@ -46,13 +49,15 @@ const skColor  Red              = skColor(0xFF0000FF);
 const skColor  Text             = skColor(0xD5D5D5FF);
 const SKuint32 RenderFlags      = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC;
 const SKuint32 WindowFlags      = SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED;
+const SKsize   PyramidBudget    = 64 << 20;
+const int      UploadsPerFrame  = 64;
 
 class PrivateApp
 {
 private:
-    typedef skArray<PixelMap*> Images;
-
-    Images            m_textures;
+    TileCache         m_cache;
+    TilePyramid       m_pyramid;
+    TileBuilder       m_builder;
     SDL_Window*       m_window;
     SDL_Renderer*     m_renderer;
     Font*             m_font;
@@ -75,9 +80,13 @@ private:
     int               m_maxCellY;
     int               m_panStepX;
     int               m_panStepY;
+    SKsize            m_tiles;
+    int               m_rows;
+    bool              m_pyramidReady;
 
 public:
     PrivateApp(FimgApplication* parent) :
+        m_cache(parent->m_cacheSize, (SKsize)parent->m_max * parent->m_max * 3 / 2),
         m_window(nullptr),
         m_renderer(nullptr),
         m_font(nullptr),
@@ -95,7 +104,10 @@ public:
         m_maxCellX(0),
         m_maxCellY(0),
         m_panStepX(0),
-        m_panStepY(0)
+        m_panStepY(0),
+        m_tiles(0),
+        m_rows(1),
+        m_pyramidReady(false)
     {
     }
 
@@ -103,9 +115,8 @@ public:
     {
         delete m_font;
 
-        Images::Iterator it = m_textures.iterator();
-        while (it.hasMoreElements())
-            delete it.getNext();
+        // the textures belong to the renderer
+        m_cache.clear();
 
         if (m_renderer)
             SDL_DestroyRenderer(m_renderer);
@@ -116,13 +127,9 @@ public:
         SDL_Quit();
     }
 
-    void setColor(const skPixel& color) const
+    void setColor(const skColor& color) const
     {
-        SDL_SetRenderDrawColor(m_renderer,
-                               color.r,
-                               color.g,
-                               color.b,
-                               color.a);
+        DrawUtils::SetColor(m_renderer, color);
     }
 
     void fixedPan()
@@ -216,7 +223,7 @@ public:
         m_panStepX = 0;
         m_panStepY = 0;
 
-        skScalar sval = (skScalar)m_textures.size();
+        skScalar sval = (skScalar)m_tiles;
         sval          = skSqrt(sval);
 
         const skScalar lim = m_mapCellSq * sval;
@@ -465,33 +472,11 @@ public:
         DrawUtils::Clear(m_renderer, Background2);
 
         DrawUtils::SetViewport(m_renderer, m_xForm);
-        skScalar x1, y1, x2, y2;
-
-        Images::Iterator it = m_textures.iterator();
-        while (it.hasMoreElements())
-        {
-            PixelMap* map = it.getNext();
-
-            map->getPosition().getBounds(x1, y1, x2, y2);
-
-            x1 = m_xForm.getViewX(x1), x2 = m_xForm.getViewX(x2);
-            y1 = m_xForm.getViewY(y1), y2 = m_xForm.getViewY(y2);
-
-            if (m_xForm.isInViewport(x1, y1, x2, y2))
-            {
-                const SDL_Rect dest = {
-                    (int)x1,
-                    (int)y1,
-                    (int)(x2 - x1),
-                    (int)(y2 - y1),
-                };
 
-                SDL_RenderCopy(m_renderer,
-                               map->getTexture(),
-                               nullptr,
-                               &dest);
-            }
-        }
+        m_cache.nextFrame();
+        m_builder.dropRequests();
+        uploadTiles();
+        renderTiles();
 
         if (m_showGrid)
             displayGrid();
@@ -506,22 +491,20 @@ public:
         char buf[32] = {};
         if (xArray >= 0)
         {
-            SKuint32 i1 = (SKuint32)xArray * (SKuint32)m_maxCellX + (SKuint32)yArray;
+            const SKsize i1 = (SKsize)xArray * (SKsize)m_rows + (SKsize)yArray;
+
+            SKsize address = (SKsize)(yMap * SKuint32(m_mapCell)) + (SKsize)xMap;
+            address += SKsize(m_mapCellSq) * i1;
 
-            if (i1 < m_textures.size())
+            if (i1 < m_tiles && address < m_parent->m_size)
             {
-                const SKubyte b = m_textures.at(i1)->getByte(xMap, yMap);
+                const SKubyte b = m_parent->m_data[address];
 
                 SKbyte cc = ' ';
                 if (b >= 32 && b < 127)
                     cc = b;
 
-                i1 = (SKuint32)xArray * (SKuint32)m_maxCellX + (SKuint32)yArray;
-
-                SKuint32 address = (SKuint32)(yMap * SKuint32(m_mapCell)) + (SKuint32)xMap;
-                address += SKuint32(m_mapCellSq) * i1;
-
-                int len  = skSprintf(buf, 31, "0x%08X", address);
+                int len  = skSprintf(buf, 31, "0x%08llX", (unsigned long long)address);
                 buf[len] = 0;
                 m_font->draw(m_renderer, buf, m_xForm.viewportRight(), 10);
 
@@ -536,42 +519,160 @@ public:
         SDL_RenderPresent(m_renderer);
     }
 
-    void buildMaps()
+    // Draws the tiles that overlap the viewport and requests the ones
+    // that are not in the cache. Zoomed out views draw the level of
+    // the pyramid whose texels are closest to one screen pixel.
+    void renderTiles()
     {
-        m_textures.reserve(m_parent->m_images.size());
+        skScalar x1, y1, x2, y2;
+
+        // bytes per screen pixel along an axis
+        const skScalar span = m_xForm.getZoom() / m_mapCell;
 
-        const int modStep = (int)skSqrt((skScalar)m_parent->m_images.size());
+        SKuint32 level = 0;
+        while (level < m_pyramid.getTopLevel() && skScalar((SKsize)2 << level) <= span)
+            ++level;
 
-        m_maxCellY = modStep - 1;
-        m_maxCellX = 0;
-        int y      = 0;
+        const skScalar size = m_mapCellSq * skScalar((SKsize)1 << level);
 
-        skRectangle workingRect(0, 0, m_mapCellSq, m_mapCellSq);
+        // the part of the grid in view, in tiles of the level
+        const skScalar left   = m_xForm.getScreenX(0) / size;
+        const skScalar right  = m_xForm.getScreenX(m_xForm.viewportWidth()) / size;
+        const skScalar top    = m_xForm.getScreenY(0) / size;
+        const skScalar bottom = m_xForm.getScreenY(m_xForm.viewportHeight()) / size;
 
-        for (SKuint32 i = 0; i < m_parent->m_images.size(); ++i)
+        const int c1 = skMax(0, (int)skFloor(skMin(left, right)));
+        const int c2 = skMin(m_maxCellX >> level, (int)skFloor(skMax(left, right)));
+        const int r1 = skMax(0, (int)skFloor(skMin(top, bottom)));
+        const int r2 = skMin((m_rows - 1) >> level, (int)skFloor(skMax(top, bottom)));
+
+        for (int c = c1; c <= c2; ++c)
         {
-            skImage* image = m_parent->m_images[i];
+            for (int r = r1; r <= r2; ++r)
+            {
+                // the first tile of the grid that it covers
+                const SKsize index = ((SKsize)c << level) * (SKsize)m_rows + ((SKsize)r << level);
+                if (index >= m_tiles)
+                    break;
+
+                const skRectangle rect(skScalar(c) * size,
+                                       skScalar(r) * size,
+                                       size,
+                                       size);
+
+                rect.getBounds(x1, y1, x2, y2);
+
+                x1 = m_xForm.getViewX(x1), x2 = m_xForm.getViewX(x2);
+                y1 = m_xForm.getViewY(y1), y2 = m_xForm.getViewY(y2);
+
+                if (!m_xForm.isInViewport(x1, y1, x2, y2))
+                    continue;
+
+                const TileCache::Key key = TileCache::makeKey(level, (SKuint32)c, (SKuint32)r);
+
+                const SDL_Rect dest = {
+                    (int)x1,
+                    (int)y1,
+                    (int)(x2 - x1),
+                    (int)(y2 - y1),
+                };
 
-            SK_ASSERT(image->getWidth() == m_parent->m_max);
-            SK_ASSERT(image->getHeight() == m_parent->m_max);
+                PixelMap* map = m_cache.find(key);
+                if (!map)
+                {
+                    // the summary levels may still be in progress
+                    if (m_pyramid.isBuilt(level))
+                        m_builder.request(key, level, (SKsize)c, (SKsize)r);
 
-            workingRect.x = skScalar(m_maxCellX) * m_mapCellSq;
-            workingRect.y = skScalar(y) * m_mapCellSq;
+                    drawAncestor(level, c, r, dest);
+                    continue;
+                }
 
-            PixelMap* px = new PixelMap(image, workingRect);
+                SDL_RenderCopy(m_renderer,
+                               map->getTexture(),
+                               nullptr,
+                               &dest);
+            }
+        }
+    }
 
-            px->loadFromImage(m_renderer, skPixel(LineColor.asInt()));
+    // Uploads the tiles that the workers have finished, a few per
+    // frame so that input stays responsive.
+    void uploadTiles()
+    {
+        const SKuint32 max = m_parent->m_max;
 
-            m_textures.push_back(px);
+        TileBuilder::Tile tile;
+        for (int i = 0; i < UploadsPerFrame && m_builder.take(tile); ++i)
+        {
+            const skScalar size = m_mapCellSq * skScalar((SKsize)1 << tile.level);
 
-            if (++y % modStep == 0)
+            // null when every map is in view, the tile is requested again
+            PixelMap* map = m_cache.insert(tile.key);
+            if (map)
             {
-                y = 0;
-                m_maxCellX++;
+                map->setPosition(skRectangle(skScalar(tile.column) * size,
+                                             skScalar(tile.row) * size,
+                                             size,
+                                             size));
+                map->load(m_renderer, tile.pixels, max, LineColor);
             }
+            m_builder.release(tile);
+        }
+    }
+
+    // Fills in a missing tile with its part of the closest
+    // cached tile above it.
+    void drawAncestor(SKuint32 level, int c, int r, const SDL_Rect& dest)
+    {
+        const SKuint32 max = m_parent->m_max;
+
+        for (SKuint32 k = 1; level + k <= m_pyramid.getTopLevel() && (max >> k) > 0; ++k)
+        {
+            PixelMap* map = m_cache.find(TileCache::makeKey(level + k, (SKuint32)(c >> k), (SKuint32)(r >> k)));
+            if (!map)
+                continue;
+
+            const int span = (int)(max >> k);
+            const int mask = (1 << k) - 1;
+
+            const SDL_Rect src = {
+                (c & mask) * span,
+                (r & mask) * span,
+                span,
+                span,
+            };
+
+            SDL_RenderCopy(m_renderer, map->getTexture(), &src, &dest);
+            return;
         }
+    }
 
-        m_parent->m_images.clear();
+    // Places the tiles in columns of m_rows, the same layout that
+    // was used when every tile was loaded up front.
+    void layoutTiles()
+    {
+        const SKsize tileSize = (SKsize)m_parent->m_max * m_parent->m_max;
+
+        m_tiles = (m_parent->m_size + tileSize - 1) / tileSize;
+        m_rows  = skMax(1, (int)skSqrt((skScalar)m_tiles));
+
+        m_maxCellY = m_rows - 1;
+        m_maxCellX = (int)(m_tiles / (SKsize)m_rows);
+
+        m_pyramid.create(m_parent->m_data,
+                         m_parent->m_size,
+                         m_parent->m_max,
+                         (SKsize)m_maxCellX + 1,
+                         (SKsize)m_rows,
+                         PyramidBudget);
+
+        m_builder.start(m_parent->m_data,
+                        m_parent->m_size,
+                        m_parent->m_max,
+                        (SKsize)m_rows,
+                        &m_pyramid,
+                        m_parent->m_lod);
     }
 
     void run(const SKint32 w, const SKint32 h)
@@ -582,6 +683,9 @@ public:
             return;
         }
 
+        // full range, so a byte's luminance is its grey level
+        SDL_SetYUVConversionMode(SDL_YUV_CONVERSION_JPEG);
+
         m_window = SDL_CreateWindow("File Byte Viewer",
                                     SDL_WINDOWPOS_CENTERED,
                                     SDL_WINDOWPOS_CENTERED,
@@ -612,13 +716,24 @@ public:
         m_font->loadInternal(m_renderer, 48, 72);
         m_font->setPointScale(12);
 
-        buildMaps();
+        layoutTiles();
         setInitial();
 
         m_showGrid = true;
         while (!m_quit)
         {
             processEvents();
+
+            // show the summary levels once the background pass is done
+            if (!m_pyramidReady && m_pyramid.isReady())
+            {
+                m_pyramidReady = true;
+                m_redraw       = true;
+            }
+
+            if (m_builder.hasResults())
+                m_redraw = true;
+
             if (!m_redraw)
                 SDL_Delay(1);
             else
@@ -630,14 +745,6 @@ public:
     }
 };
 
-void FimgApplication::clear()
-{
-    Images::Iterator it = m_images.iterator();
-    while (it.hasMoreElements())
-        delete it.getNext();
-    m_images.clear();
-}
-
 void FimgApplication::run(const SKint32 w, const SKint32 h)
 {
     PrivateApp app(this);
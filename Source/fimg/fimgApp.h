@@ -22,31 +22,31 @@
 #ifndef _freqApp_h_
 #define _freqApp_h_
 
-#include "Image/skImage.h"
-#include "Utils/skArray.h"
+#include "Utils/skString.h"
 
 class FimgApplication
 {
-public:
-    typedef skArray<skImage*> Images;
-
 protected:
-    Images   m_images;
-    SKuint32 m_max;
+    const SKuint8* m_data;
+    SKsize         m_size;
+    SKuint32       m_max;
+    SKsize         m_cacheSize;
+    SKuint32       m_lod;
 
     friend class PrivateApp;
 
-    void clear();
-
 public:
     FimgApplication() :
-        m_max(0)
+        m_data(nullptr),
+        m_size(0),
+        m_max(0),
+        m_cacheSize(0),
+        m_lod(0)
     {
     }
 
     virtual ~FimgApplication()
     {
-        clear();
     }
 
     void run(SKint32 w, SKint32 h);
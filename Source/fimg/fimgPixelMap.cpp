@@ -22,58 +22,63 @@
 #include "fimgPixelMap.h"
 #include "SDL.h"
 #include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
 
-PixelMap::PixelMap(skImage* image, const skRectangle& gridPos) :
-    m_texture(nullptr),
-    m_gridPos(gridPos),
-    m_image(image)
+PixelMap::PixelMap() :
+    m_texture(nullptr)
 {
 }
 
 PixelMap::~PixelMap()
 {
-    delete m_image;
+    release();
+}
 
+void PixelMap::release()
+{
     if (m_texture)
         SDL_DestroyTexture(m_texture);
+    m_texture = nullptr;
 }
 
-void PixelMap::loadFromImage(SDL_Renderer* renderer, const skPixel& color)
+void PixelMap::load(SDL_Renderer* renderer, const SKuint8* luminance, SKuint32 size, const skColor& color)
 {
-    if (m_image == nullptr)
-    {
-        skLogd(LD_ERROR, "invalid pixel map image\n");
-        return;
-    }
+    // The chroma planes of a grey tile, up to 256 / 2 squared. A tile is
+    // uploaded as IYUV, so its luminance goes up as is.
+    static SKuint8 chroma[128 * 128];
+    if (chroma[0] != 128)
+        skMemset(chroma, 128, sizeof chroma);
 
-    if (m_texture)
+    if (!m_texture)
     {
-        skLogd(LD_ERROR, "texture has already been loaded.\n");
-        return;
-    }
+        m_texture = SDL_CreateTexture(renderer,
+                                      SDL_PIXELFORMAT_IYUV,
+                                      SDL_TEXTUREACCESS_STATIC,
+                                      size,
+                                      size);
+        if (!m_texture)
+        {
+            skLogf(LD_ERROR, "failed to create a tile texture:\n\t%s\n", SDL_GetError());
+            return;
+        }
 
-    m_texture = SDL_CreateTexture(renderer,
-                                  SDL_PIXELFORMAT_ARGB8888,
-                                  SDL_TEXTUREACCESS_STATIC,
-                                  m_image->getWidth(),
-                                  m_image->getHeight());
-    if (m_texture != nullptr)
-    {
-        SDL_UpdateTexture(m_texture, nullptr, m_image->getBytes(), m_image->getPitch());
-        SDL_SetTextureColorMod(m_texture, color.r, color.g, color.b);
+        SKuint8 r, g, b, a;
+        color.asInt8(r, g, b, a);
+
+        // Black adds nothing with additive blending, so bytes past the
+        // end of the data need no alpha of their own.
+        SDL_SetTextureColorMod(m_texture, r, g, b);
+        SDL_SetTextureAlphaMod(m_texture, 128);
         SDL_SetTextureScaleMode(m_texture, SDL_ScaleModeNearest);
         SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_ADD);
     }
-}
 
-SKuint8 PixelMap::getByte(SKuint32 x, SKuint32 y) const
-{
-    SKuint8 rc = 0;
-    if (m_image)
-    {
-        skPixel px;
-        m_image->getPixel(x, m_image->getHeight() - 1 - y, px);
-        rc = px.r;
-    }
-    return rc;
+    SDL_UpdateYUVTexture(m_texture,
+                         nullptr,
+                         luminance,
+                         (int)size,
+                         chroma,
+                         (int)size / 2,
+                         chroma,
+                         (int)size / 2);
 }
@@ -22,24 +22,33 @@
 #ifndef _fimgPixelMap_h_
 #define _fimgPixelMap_h_
 
-#include "Image/skImage.h"
+#include "Math/skColor.h"
 #include "Math/skRectangle.h"
 
 struct SDL_Texture;
 struct SDL_Renderer;
 
+// The texture of one tile and the rectangle it covers on the grid. A map
+// is reused for other tiles of the same size, which update its texture.
 class PixelMap
 {
 private:
-    SDL_Texture*      m_texture;
-    const skRectangle m_gridPos;
-    skImage*          m_image;
+    SDL_Texture* m_texture;
+    skRectangle  m_gridPos;
 
 public:
-    PixelMap(skImage* image, const skRectangle& gridPos);
+    PixelMap();
     ~PixelMap();
 
-    void loadFromImage(SDL_Renderer* renderer, const skPixel& color);
+    // Uploads size by size luminance bytes stored top down.
+    void load(SDL_Renderer* renderer, const SKuint8* luminance, SKuint32 size, const skColor& color);
+
+    void release();
+
+    SK_INLINE void setPosition(const skRectangle& gridPos)
+    {
+        m_gridPos = gridPos;
+    }
 
     SK_INLINE SDL_Texture* getTexture() const
     {
@@ -50,8 +59,6 @@ public:
     {
         return m_gridPos;
     }
-
-    SKuint8 getByte(SKuint32 x, SKuint32 y) const;
 };
 
 #endif  //_fimgPixelMap_h_
@@ -0,0 +1,192 @@
+/*
+-------------------------------------------------------------------------------
+  Copyright (c) Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "fimgTileBuilder.h"
+#include "Utils/skMemoryUtils.h"
+
+const SKsize BuffersPerSlab = 64;
+
+TileBuilder::TileBuilder() :
+    m_data(nullptr),
+    m_size(0),
+    m_max(0),
+    m_rows(0),
+    m_pyramid(nullptr),
+    m_channel(0),
+    m_quit(false)
+{
+}
+
+TileBuilder::~TileBuilder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& worker : m_workers)
+        worker.join();
+
+    for (SKuint8* slab : m_slabs)
+        delete[] slab;
+}
+
+void TileBuilder::start(const SKuint8*     data,
+                        SKsize             size,
+                        SKuint32           max,
+                        SKsize             rows,
+                        const TilePyramid* pyramid,
+                        SKuint32           channel)
+{
+    m_data    = data;
+    m_size    = size;
+    m_max     = max;
+    m_rows    = rows;
+    m_pyramid = pyramid;
+    m_channel = channel;
+
+    // leave a thread for the renderer
+    const unsigned int n = std::thread::hardware_concurrency();
+    for (unsigned int i = 0; i < (n > 1 ? n - 1 : 1); ++i)
+        m_workers.emplace_back(&TileBuilder::work, this);
+}
+
+void TileBuilder::request(TileCache::Key key, SKuint32 level, SKsize column, SKsize row)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending.insert(key).second)
+            return;
+
+        m_requests.push_back({key, level, column, row, nullptr});
+    }
+    m_wake.notify_one();
+}
+
+void TileBuilder::dropRequests()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const Tile& tile : m_requests)
+        m_pending.erase(tile.key);
+    m_requests.clear();
+}
+
+bool TileBuilder::take(Tile& tile)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_results.empty())
+        return false;
+
+    tile = m_results.front();
+    m_results.pop_front();
+    m_pending.erase(tile.key);
+    return true;
+}
+
+bool TileBuilder::hasResults()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_results.empty();
+}
+
+SKuint8* TileBuilder::allocate()
+{
+    if (m_free.empty())
+    {
+        const SKsize count = (SKsize)m_max * m_max;
+
+        SKuint8* slab = new SKuint8[BuffersPerSlab * count];
+        m_slabs.push_back(slab);
+
+        for (SKsize i = 0; i < BuffersPerSlab; ++i)
+            m_free.push_back(slab + i * count);
+    }
+
+    SKuint8* buffer = m_free.back();
+    m_free.pop_back();
+    return buffer;
+}
+
+void TileBuilder::release(Tile& tile)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(tile.pixels);
+    tile.pixels = nullptr;
+}
+
+void TileBuilder::work()
+{
+    Texel* texels = new Texel[(SKsize)m_max * m_max];
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wake.wait(lock, [this] { return m_quit || !m_requests.empty(); });
+        if (m_quit)
+            break;
+
+        Tile tile = m_requests.front();
+        m_requests.pop_front();
+        tile.pixels = allocate();
+        lock.unlock();
+
+        const bool built = build(tile, texels);
+
+        lock.lock();
+        if (built)
+            m_results.push_back(tile);
+        else
+        {
+            m_free.push_back(tile.pixels);
+            m_pending.erase(tile.key);
+        }
+    }
+
+    delete[] texels;
+}
+
+bool TileBuilder::build(Tile& tile, Texel* texels) const
+{
+    const SKsize count = (SKsize)m_max * m_max;
+
+    if (tile.level == 0)
+    {
+        // The rows of a tile are contiguous in the file and drawn top
+        // down, so the tile is a straight copy of its bytes.
+        const SKsize offset = (tile.column * m_rows + tile.row) * count;
+        const SKsize len    = offset < m_size ? skMin(count, m_size - offset) : 0;
+
+        skMemcpy(tile.pixels, m_data + offset, len);
+        skMemset(tile.pixels + len, 0, count - len);
+        return true;
+    }
+
+    if (!m_pyramid->getTile(tile.level, tile.column, tile.row, texels))
+        return false;
+
+    for (SKsize i = 0; i < count; ++i)
+    {
+        const Texel& t = texels[i];
+        tile.pixels[i] = t.min <= t.max ? TilePyramid::getChannel(t, m_channel) : 0;
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+-------------------------------------------------------------------------------
+  Copyright (c) Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _fimgTileBuilder_h_
+#define _fimgTileBuilder_h_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "fimgTileCache.h"
+#include "fimgTilePyramid.h"
+
+// Builds the pixels of tiles on a pool of worker threads. The render thread
+// requests the tiles that it is missing and uploads the finished ones.
+class TileBuilder
+{
+public:
+    struct Tile
+    {
+        TileCache::Key key;
+        SKuint32       level;
+        SKsize         column;
+        SKsize         row;
+        SKuint8*       pixels;
+    };
+
+private:
+    typedef TilePyramid::Texel                 Texel;
+    typedef std::deque<Tile>                   Queue;
+    typedef std::unordered_set<TileCache::Key> KeySet;
+    typedef std::vector<SKuint8*>              Buffers;
+
+    const SKuint8*           m_data;
+    SKsize                   m_size;
+    SKuint32                 m_max;
+    SKsize                   m_rows;
+    const TilePyramid*       m_pyramid;
+    SKuint32                 m_channel;
+    std::vector<std::thread> m_workers;
+    std::mutex               m_mutex;
+    std::condition_variable  m_wake;
+    Queue                    m_requests;
+    Queue                    m_results;
+    KeySet                   m_pending;
+    Buffers                  m_slabs;
+    Buffers                  m_free;
+    bool                     m_quit;
+
+    // Takes a pixel buffer from the free list, carving a new slab
+    // of them when it is empty. Called with m_mutex held.
+    SKuint8* allocate();
+
+    void work();
+
+    bool build(Tile& tile, Texel* texels) const;
+
+public:
+    TileBuilder();
+    ~TileBuilder();
+
+    // Starts the workers on a grid with rows tiles per column, each
+    // max by max bytes of data. Tiles past level zero are read from
+    // the pyramid using the summary channel.
+    void start(const SKuint8*     data,
+               SKsize             size,
+               SKuint32           max,
+               SKsize             rows,
+               const TilePyramid* pyramid,
+               SKuint32           channel);
+
+    // Queues a tile unless it is already queued, being built or
+    // waiting to be taken.
+    void request(TileCache::Key key, SKuint32 level, SKsize column, SKsize row);
+
+    // Forgets the requests that no worker has started.
+    void dropRequests();
+
+    // Moves a finished tile into tile. The caller releases its pixels.
+    bool take(Tile& tile);
+
+    bool hasResults();
+
+    // Returns the pixels of a taken tile to the free list.
+    void release(Tile& tile);
+};
+
+#endif  //_fimgTileBuilder_h_
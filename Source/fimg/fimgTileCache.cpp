@@ -0,0 +1,211 @@
+/*
+-------------------------------------------------------------------------------
+  Copyright (c) Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "fimgTileCache.h"
+#include "Utils/skMemoryUtils.h"
+
+const SKsize SlabSize     = 1024;
+const SKsize InitialSlots = 1 << 10;
+
+TileCache::TileCache(SKsize budget, SKsize tileSize) :
+    m_size(0),
+    m_capacity(skMax<SKsize>(budget / skMax<SKsize>(tileSize, 1), 1)),
+    m_tileSize(tileSize),
+    m_slots(nullptr),
+    m_slotCapacity(0),
+    m_head(nullptr),
+    m_tail(nullptr),
+    m_frame(0)
+{
+    rehash(InitialSlots);
+}
+
+TileCache::~TileCache()
+{
+    clear();
+
+    for (Entry* slab : m_slabs)
+        delete[] slab;
+    delete[] m_slots;
+}
+
+void TileCache::unlink(Entry* ent)
+{
+    if (ent->prev)
+        ent->prev->next = ent->next;
+    else
+        m_head = ent->next;
+
+    if (ent->next)
+        ent->next->prev = ent->prev;
+    else
+        m_tail = ent->prev;
+
+    ent->prev = nullptr;
+    ent->next = nullptr;
+}
+
+void TileCache::pushFront(Entry* ent)
+{
+    ent->prev = nullptr;
+    ent->next = m_head;
+    if (m_head)
+        m_head->prev = ent;
+    else
+        m_tail = ent;
+    m_head = ent;
+}
+
+TileCache::Entry* TileCache::allocate()
+{
+    if (m_size < m_capacity)
+    {
+        const SKsize slab = m_size / SlabSize;
+        if (slab == m_slabs.size())
+            m_slabs.push_back(new Entry[SlabSize]);
+
+        Entry* ent = m_slabs[slab] + m_size % SlabSize;
+        ++m_size;
+        return ent;
+    }
+
+    // full, so the oldest entry is reused in place
+    Entry* ent = m_tail;
+    if (!ent || ent->frame == m_frame)
+        return nullptr;
+
+    unlink(ent);
+    erase(ent->key);
+    return ent;
+}
+
+SKsize TileCache::slotOf(Key key) const
+{
+    SKuint64 h = key * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 32;
+    return (SKsize)h & (m_slotCapacity - 1);
+}
+
+void TileCache::erase(Key key)
+{
+    const SKsize mask = m_slotCapacity - 1;
+
+    SKsize i = slotOf(key);
+    while (m_slots[i]->key != key)
+        i = (i + 1) & mask;
+
+    // Shift the rest of the run back over the hole, leaving
+    // any entry that is already at or past its home slot.
+    for (SKsize j = (i + 1) & mask; m_slots[j]; j = (j + 1) & mask)
+    {
+        const SKsize k = slotOf(m_slots[j]->key);
+        if (i <= j ? (k <= i || k > j) : (k <= i && k > j))
+        {
+            m_slots[i] = m_slots[j];
+            i          = j;
+        }
+    }
+    m_slots[i] = nullptr;
+}
+
+void TileCache::rehash(SKsize capacity)
+{
+    Entry**      slots = m_slots;
+    const SKsize old   = m_slotCapacity;
+
+    m_slots        = new Entry*[capacity];
+    m_slotCapacity = capacity;
+    skMemset(m_slots, 0, sizeof(Entry*) * capacity);
+
+    const SKsize mask = capacity - 1;
+    for (SKsize i = 0; i < old; ++i)
+    {
+        if (slots[i])
+        {
+            SKsize s = slotOf(slots[i]->key);
+            while (m_slots[s])
+                s = (s + 1) & mask;
+            m_slots[s] = slots[i];
+        }
+    }
+    delete[] slots;
+}
+
+PixelMap* TileCache::find(Key key)
+{
+    const SKsize mask = m_slotCapacity - 1;
+
+    SKsize s = slotOf(key);
+    while (m_slots[s] && m_slots[s]->key != key)
+        s = (s + 1) & mask;
+
+    Entry* ent = m_slots[s];
+    if (!ent)
+        return nullptr;
+
+    if (ent != m_head)
+    {
+        unlink(ent);
+        pushFront(ent);
+    }
+    ent->frame = m_frame;
+    return &ent->map;
+}
+
+PixelMap* TileCache::insert(Key key)
+{
+    Entry* ent = allocate();
+    if (!ent)
+        return nullptr;
+
+    ent->key   = key;
+    ent->frame = m_frame;
+    pushFront(ent);
+
+    // keep the load factor at or below one half
+    if (m_size >= m_slotCapacity / 2)
+        rehash(m_slotCapacity * 2);
+
+    const SKsize mask = m_slotCapacity - 1;
+
+    SKsize s = slotOf(key);
+    while (m_slots[s])
+        s = (s + 1) & mask;
+    m_slots[s] = ent;
+
+    return &ent->map;
+}
+
+void TileCache::nextFrame()
+{
+    ++m_frame;
+}
+
+void TileCache::clear()
+{
+    for (SKsize i = 0; i < m_size; ++i)
+        m_slabs[i / SlabSize][i % SlabSize].map.release();
+
+    skMemset(m_slots, 0, sizeof(Entry*) * m_slotCapacity);
+    m_head = nullptr;
+    m_tail = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,101 @@
+/*
+-------------------------------------------------------------------------------
+  Copyright (c) Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _fimgTileCache_h_
+#define _fimgTileCache_h_
+
+#include <vector>
+#include "fimgPixelMap.h"
+
+// Least recently used set of tile textures. Entries are carved out of
+// slabs as the cache fills and are reused in place once it holds as many
+// tiles as fit in the budget, so a full cache allocates nothing. The
+// texture of a reused entry is updated rather than recreated. Tiles drawn
+// in the current frame are never reused.
+class TileCache
+{
+public:
+    typedef SKuint64 Key;
+
+private:
+    struct Entry
+    {
+        Key      key;
+        PixelMap map;
+        SKuint32 frame;
+        Entry*   prev;
+        Entry*   next;
+    };
+
+    typedef std::vector<Entry*> Slabs;
+
+    Slabs    m_slabs;
+    SKsize   m_size;
+    SKsize   m_capacity;
+    SKsize   m_tileSize;
+    Entry**  m_slots;
+    SKsize   m_slotCapacity;
+    Entry*   m_head;
+    Entry*   m_tail;
+    SKuint32 m_frame;
+
+    void unlink(Entry* ent);
+
+    void pushFront(Entry* ent);
+
+    Entry* allocate();
+
+    SKsize slotOf(Key key) const;
+
+    void erase(Key key);
+
+    void rehash(SKsize capacity);
+
+public:
+    // Holds as many tiles of tileSize bytes as fit in budget.
+    TileCache(SKsize budget, SKsize tileSize);
+    ~TileCache();
+
+    // Returns the map of key and marks it as used
+    // in this frame, or null if it is not loaded.
+    PixelMap* find(Key key);
+
+    // Returns the map to load key into, or null if every map
+    // in the cache is drawn in this frame.
+    PixelMap* insert(Key key);
+
+    void nextFrame();
+
+    void clear();
+
+    // Keys a tile by its level in the pyramid and its column and row.
+    static SK_INLINE Key makeKey(SKuint32 level, SKuint32 column, SKuint32 row)
+    {
+        return (Key)level << 58 | (Key)column << 29 | (Key)row;
+    }
+
+    SK_INLINE SKsize getUsed() const
+    {
+        return m_size * m_tileSize;
+    }
+};
+
+#endif  //_fimgTileCache_h_
@@ -0,0 +1,324 @@
+/*
+-------------------------------------------------------------------------------
+  Copyright (c) Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "fimgTilePyramid.h"
+#include <cmath>
+#include <vector>
+
+const TilePyramid::Texel EmptyTexel = {0, 255, 0, 0};
+
+TilePyramid::TilePyramid() :
+    m_data(nullptr),
+    m_size(0),
+    m_max(1),
+    m_rows(0),
+    m_width(0),
+    m_height(0),
+    m_summary(1),
+    m_top(0),
+    m_levels(nullptr),
+    m_ready(false),
+    m_cancel(false)
+{
+}
+
+TilePyramid::~TilePyramid()
+{
+    m_cancel = true;
+    if (m_worker.joinable())
+        m_worker.join();
+
+    if (m_levels)
+    {
+        for (SKuint32 i = m_summary; i <= m_top; ++i)
+            delete[] m_levels[i - m_summary].texels;
+        delete[] m_levels;
+    }
+}
+
+void TilePyramid::create(const SKuint8* data,
+                         SKsize         size,
+                         SKuint32       max,
+                         SKsize         columns,
+                         SKsize         rows,
+                         SKsize         budget)
+{
+    m_data   = data;
+    m_size   = size;
+    m_max    = max;
+    m_rows   = rows;
+    m_width  = columns * max;
+    m_height = rows * max;
+
+    // the top level holds the whole grid in one tile
+    m_top = 0;
+    while ((m_width + ((SKsize)1 << m_top) - 1) >> m_top > max ||
+           (m_height + ((SKsize)1 << m_top) - 1) >> m_top > max)
+        ++m_top;
+
+    if (m_top == 0)
+    {
+        m_ready = true;
+        return;
+    }
+
+    // The lowest level whose levels up to the top fit in the budget, along
+    // with the weights of the two lowest ones that are held while reducing.
+    for (m_summary = 1; m_summary < m_top; ++m_summary)
+    {
+        SKsize total = 0;
+        for (SKuint32 i = m_summary; i <= m_top; ++i)
+        {
+            const SKsize s      = (SKsize)1 << i;
+            const SKsize texels = ((m_width + s - 1) >> i) * ((m_height + s - 1) >> i);
+
+            total += texels * sizeof(Texel);
+            if (i <= m_summary + 1)
+                total += texels * sizeof(Weight);
+        }
+
+        if (total <= budget)
+            break;
+    }
+
+    m_levels = new Level[m_top - m_summary + 1];
+    for (SKuint32 i = m_summary; i <= m_top; ++i)
+    {
+        const SKsize s = (SKsize)1 << i;
+
+        Level& level = m_levels[i - m_summary];
+        level.width  = (m_width + s - 1) >> i;
+        level.height = (m_height + s - 1) >> i;
+        level.texels = new Texel[level.width * level.height];
+    }
+
+    m_worker = std::thread(&TilePyramid::build, this);
+}
+
+TilePyramid::Weight TilePyramid::summarize(SKuint32 level, SKsize tx, SKsize ty, Texel& dest, SKuint32* hist) const
+{
+    const SKsize s        = (SKsize)1 << level;
+    const SKsize tileSize = (SKsize)m_max * m_max;
+    const SKsize x1       = tx * s;
+    const SKsize x2       = skMin(x1 + s, m_width);
+    const SKsize y1       = ty * s;
+    const SKsize y2       = skMin(y1 + s, m_height);
+
+    SKuint64 sum = 0;
+    SKsize   n   = 0;
+    SKuint32 lo = 255, hi = 0;
+
+    for (SKsize y = y1; y < y2; ++y)
+    {
+        const SKsize row = y / m_max;
+        const SKsize py  = y % m_max;
+
+        // walk the spans of the row that lie in one tile
+        for (SKsize x = x1; x < x2;)
+        {
+            const SKsize column = x / m_max;
+            const SKsize end    = skMin(x2, (column + 1) * m_max);
+            const SKsize offset = (column * m_rows + row) * tileSize + py * m_max + x % m_max;
+
+            if (offset < m_size)
+            {
+                const SKsize   len = skMin(end - x, m_size - offset);
+                const SKuint8* p   = m_data + offset;
+
+                for (SKsize i = 0; i < len; ++i)
+                {
+                    const SKuint32 c = p[i];
+
+                    sum += c;
+                    lo = skMin(lo, c);
+                    hi = skMax(hi, c);
+                    hist[c]++;
+                }
+                n += len;
+            }
+            x = end;
+        }
+    }
+
+    if (n == 0)
+    {
+        dest = EmptyTexel;
+        return {0, 0};
+    }
+
+    // only the bins from lo to hi were touched
+    double entropy = 0;
+    for (SKuint32 c = lo; c <= hi; ++c)
+    {
+        if (hist[c])
+        {
+            const double p = double(hist[c]) / double(n);
+            entropy -= p * std::log2(p);
+            hist[c] = 0;
+        }
+    }
+
+    dest.mean    = (SKuint8)((sum + n / 2) / n);
+    dest.min     = (SKuint8)lo;
+    dest.max     = (SKuint8)hi;
+    dest.entropy = (SKuint8)(entropy * 255.0 / 8.0 + 0.5);
+    return {sum, n};
+}
+
+void TilePyramid::build()
+{
+    Level& base = m_levels[0];
+
+    std::vector<Weight> weights(base.width * base.height);
+
+    std::atomic<SKsize> next(0);
+
+    const auto work = [this, &base, &weights, &next]() {
+        SKuint32 hist[256] = {};
+        for (;;)
+        {
+            const SKsize ty = next++;
+            if (ty >= base.height || m_cancel)
+                break;
+
+            Texel*  row    = base.texels + ty * base.width;
+            Weight* weight = weights.data() + ty * base.width;
+            for (SKsize tx = 0; tx < base.width; ++tx)
+                weight[tx] = summarize(m_summary, tx, ty, row[tx], hist);
+        }
+    };
+
+    const unsigned int n = skMax(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::thread> pool;
+    for (unsigned int i = 0; i < n; ++i)
+        pool.emplace_back(work);
+
+    for (std::thread& thread : pool)
+        thread.join();
+
+    if (m_cancel)
+        return;
+
+    std::vector<Weight> reduced;
+    for (SKuint32 i = m_summary + 1; i <= m_top; ++i)
+    {
+        const Level& src  = m_levels[i - m_summary - 1];
+        Level&       dest = m_levels[i - m_summary];
+
+        reduced.resize(dest.width * dest.height);
+        reduce(src, weights.data(), dest, reduced.data());
+        weights.swap(reduced);
+    }
+
+    m_ready = true;
+}
+
+void TilePyramid::reduce(const Level& src, const Weight* from, Level& dest, Weight* to)
+{
+    for (SKsize y = 0; y < dest.height; ++y)
+    {
+        for (SKsize x = 0; x < dest.width; ++x)
+        {
+            SKuint64 sum = 0, entropy = 0, n = 0;
+            SKuint8  lo = 255, hi = 0;
+
+            for (SKsize i = 0; i < 4; ++i)
+            {
+                const SKsize sx = 2 * x + (i & 1);
+                const SKsize sy = 2 * y + (i >> 1);
+                if (sx >= src.width || sy >= src.height)
+                    continue;
+
+                const Texel&  t = src.texels[sy * src.width + sx];
+                const Weight& w = from[sy * src.width + sx];
+                if (w.count == 0)
+                    continue;
+
+                sum += w.sum;
+                entropy += t.entropy * w.count;
+                lo = skMin(lo, t.min);
+                hi = skMax(hi, t.max);
+                n += w.count;
+            }
+
+            Texel& t = dest.texels[y * dest.width + x];
+            to[y * dest.width + x] = {sum, n};
+            if (n == 0)
+                t = EmptyTexel;
+            else
+            {
+                // the entropy above the summary level is the mean entropy
+                // of its blocks by the bytes they cover, not that of the
+                // whole block
+                t.mean    = (SKuint8)((sum + n / 2) / n);
+                t.min     = lo;
+                t.max     = hi;
+                t.entropy = (SKuint8)((entropy + n / 2) / n);
+            }
+        }
+    }
+}
+
+bool TilePyramid::getTile(SKuint32 level, SKsize cx, SKsize cy, Texel* dest) const
+{
+    if (level >= m_summary && !m_ready)
+        return false;
+
+    SKuint32 hist[256] = {};
+
+    for (SKsize y = 0; y < m_max; ++y)
+    {
+        const SKsize ty = cy * m_max + y;
+        for (SKsize x = 0; x < m_max; ++x)
+        {
+            const SKsize tx = cx * m_max + x;
+
+            Texel& t = dest[y * m_max + x];
+            if (level < m_summary)
+                summarize(level, tx, ty, t, hist);
+            else
+            {
+                const Level& lev = m_levels[level - m_summary];
+                if (tx < lev.width && ty < lev.height)
+                    t = lev.texels[ty * lev.width + tx];
+                else
+                    t = EmptyTexel;
+            }
+        }
+    }
+    return true;
+}
+
+SKuint8 TilePyramid::getChannel(const Texel& texel, SKuint32 channel)
+{
+    switch (channel)
+    {
+    case CH_MIN:
+        return texel.min;
+    case CH_MAX:
+        return texel.max;
+    case CH_ENTROPY:
+        return texel.entropy;
+    default:
+        return texel.mean;
+    }
+}
@@ -0,0 +1,127 @@
+/*
+-------------------------------------------------------------------------------
+  Copyright (c) Charles Carley.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _fimgTilePyramid_h_
+#define _fimgTilePyramid_h_
+
+#include <atomic>
+#include <thread>
+#include "Utils/skString.h"
+
+// Level of detail summaries of the tile grid. A texel on level L covers a
+// 2^L by 2^L block of bytes on the grid, so a tile of level L covers 2^L by
+// 2^L tiles of the level below. The lowest level that fits the memory budget
+// is computed in parallel on a background thread and the levels above it are
+// reduced from it in memory. The levels under it are computed from the file
+// when a tile is requested.
+class TilePyramid
+{
+public:
+    enum Channel
+    {
+        CH_MEAN = 0,
+        CH_MIN,
+        CH_MAX,
+        CH_ENTROPY,
+        CH_MAX_ENUM
+    };
+
+    // A texel that covers no bytes has min greater than max.
+    struct Texel
+    {
+        SKuint8 mean;
+        SKuint8 min;
+        SKuint8 max;
+        SKuint8 entropy;
+    };
+
+private:
+    struct Level
+    {
+        Texel* texels;
+        SKsize width;
+        SKsize height;
+    };
+
+    // The bytes a texel covers and their sum. Only kept while the levels
+    // are reduced, so a partly filled block counts for what it holds.
+    struct Weight
+    {
+        SKuint64 sum;
+        SKuint64 count;
+    };
+
+    const SKuint8*    m_data;
+    SKsize            m_size;
+    SKuint32          m_max;
+    SKsize            m_rows;
+    SKsize            m_width;
+    SKsize            m_height;
+    SKuint32          m_summary;
+    SKuint32          m_top;
+    Level*            m_levels;
+    std::thread       m_worker;
+    std::atomic<bool> m_ready;
+    std::atomic<bool> m_cancel;
+
+    Weight summarize(SKuint32 level, SKsize tx, SKsize ty, Texel& dest, SKuint32* hist) const;
+
+    void build();
+
+    static void reduce(const Level& src, const Weight* from, Level& dest, Weight* to);
+
+public:
+    TilePyramid();
+    ~TilePyramid();
+
+    // Starts the background pass over a grid of columns by rows tiles,
+    // each max by max bytes of data.
+    void create(const SKuint8* data,
+                SKsize         size,
+                SKuint32       max,
+                SKsize         columns,
+                SKsize         rows,
+                SKsize         budget);
+
+    // Fills the max by max texels of tile (cx, cy) on the level. Returns
+    // false if the level is not built yet.
+    bool getTile(SKuint32 level, SKsize cx, SKsize cy, Texel* dest) const;
+
+    static SKuint8 getChannel(const Texel& texel, SKuint32 channel);
+
+    SK_INLINE SKuint32 getTopLevel() const
+    {
+        return m_top;
+    }
+
+    SK_INLINE bool isReady() const
+    {
+        return m_ready;
+    }
+
+    // True if the tiles of the level can be read with getTile.
+    SK_INLINE bool isBuilt(SKuint32 level) const
+    {
+        return level < m_summary || m_ready;
+    }
+};
+
+#endif  //_fimgTilePyramid_h_
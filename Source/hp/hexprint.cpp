@@ -17,11 +17,23 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
+#include <sys/stat.h>
 #include "Utils/CommandLine/skCommandLineParser.h"
 #include "Utils/skFileStream.h"
 #include "Utils/skHexPrint.h"
 #include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
 #include "Utils/skString.h"
+#include "hpFormatter.h"
+#include "hpPager.h"
+#include "hpReverse.h"
+#include "hpSearch.h"
+#include "hpTemplate.h"
+#include "hpWordFormatter.h"
+#include "mappedFile.h"
+#include "orderedPipeline.h"
+#include "outputBuffer.h"
+#include "sparseFile.h"
 
 using namespace skHexPrint;
 using namespace skCommandLine;
@@ -33,6 +45,18 @@ enum SwitchIds
     HP_FLAGS,
     HP_RANGE,
     HP_CSV,
+    HP_WIDTH,
+    HP_GREP,
+    HP_DIFF,
+    HP_SQUEEZE,
+    HP_REVERSE,
+    HP_EMBED,
+    HP_PAGER,
+    HP_VIEW,
+    HP_BIG_ENDIAN,
+    HP_THREADS,
+    HP_TEMPLATE,
+    HP_COLUMNS,
     HP_MAX
 };
 
@@ -41,8 +65,9 @@ const Switch Switches[HP_MAX] = {
         HP_MARK,
         'm',
         "mark",
-        "Mark a specific hexadecimal sequence.\n"
-        "  - Base 16 [00-FFFFFFFF]",
+        "Mark one or more hexadecimal sequences.\n"
+        "  - Arguments: comma separated list of sequences\n"
+        "    - Any length, ? matches any nibble [7F454C46,4D5A??00]",
         true,
         1,
     },
@@ -87,23 +112,188 @@ const Switch Switches[HP_MAX] = {
         true,
         0,
     },
+    {
+        HP_WIDTH,
+        'w',
+        "width",
+        "Specify the number of bytes per line.\n"
+        "  - Arguments: [16,32,64] or [1-256] with --csv and --embed",
+        true,
+        1,
+    },
+    {
+        HP_GREP,
+        'C',
+        "context",
+        "Only print the lines that contain a --mark sequence.\n"
+        "  - Arguments: number of lines to print before and after a match [0-1024]",
+        true,
+        1,
+    },
+    {
+        HP_DIFF,
+        'd',
+        "diff",
+        "Compare the file with another and print the lines that differ side by side.\n"
+        "  - Arguments: file to compare with",
+        true,
+        1,
+    },
+    {
+        HP_SQUEEZE,
+        's',
+        "squeeze",
+        "Replace repeated lines with a single '*' line.\n"
+        "  - File holes are skipped without being read.",
+        true,
+        0,
+    },
+    {
+        HP_REVERSE,
+        0,
+        "reverse",
+        "Convert a hex dump, --csv output or plain hex digits back into binary.\n"
+        "  - Arguments: output file",
+        true,
+        1,
+    },
+    {
+        HP_EMBED,
+        'e',
+        "embed",
+        "Write the range as a C array that can be included in a build.\n"
+        "  - Arguments: array name\n"
+        "    - The size is declared as <name>_size.\n"
+        "    - The bytes per line are set with --width [1-256].",
+        true,
+        1,
+    },
+    {
+        HP_PAGER,
+        'i',
+        "interactive",
+        "Browse the range in the terminal.\n"
+        "  - Keys: arrows, page up/down, g/G start/end, : goto address,\n"
+        "          n next --mark sequence, esc cancel search, q or ^C quit",
+        true,
+        0,
+    },
+    {
+        HP_VIEW,
+        'v',
+        "view",
+        "Print each line as words of the given type.\n"
+        "  - Arguments: [u16,u32,u64,i16,i32,i64,f32,f64]",
+        true,
+        1,
+    },
+    {
+        HP_BIG_ENDIAN,
+        0,
+        "big-endian",
+        "Read the --view words in big endian order.",
+        true,
+        0,
+    },
+    {
+        HP_THREADS,
+        0,
+        "threads",
+        "Format the range on more than one thread.\n"
+        "  - Arguments: number of threads [0-256], 0 uses one per core\n"
+        "    - Not used with --squeeze or --context.",
+        true,
+        1,
+    },
+    {
+        HP_TEMPLATE,
+        't',
+        "template",
+        "Decode the range as fixed size records and print them as CSV.\n"
+        "  - Arguments: template file with one field per line\n"
+        "    - name type[count] [@offset], where type is one of\n"
+        "      u8,u16,u32,u64,i8,i16,i32,i64,f32,f64,char\n"
+        "      with an optional le or be suffix\n"
+        "    - size N sets the record size, endian little|big the byte order",
+        true,
+        1,
+    },
+    {
+        HP_COLUMNS,
+        0,
+        "columns",
+        "Write each --template column to its own binary file instead.\n"
+        "  - Arguments: path prefix, files are named <prefix>.<column>.bin",
+        true,
+        1,
+    },
 };
 
+const SKsize ChunkSize = 1 << 20;
+const SKsize DiffBlock = 1 << 16;
+
 class Application
 {
 private:
-    skFileStream m_stream;
-    SKint64      m_code;
-    SKuint32     m_addressRange[2];
-    SKuint32     m_flags;
-    bool         m_csv;
+    skFileStream    m_stream;
+    PatternSearch   m_search;
+    SKuint32        m_addressRange[2];
+    SKuint32        m_flags;
+    SKuint32        m_width;
+    SKint32         m_context;
+    bool            m_csv;
+    SKuint32        m_column;
+    skString        m_embed;
+    bool            m_squeeze;
+    bool            m_squeezed;
+    SKuint8         m_previous[HexFormatter::MaxWidth];
+    SparseFile      m_sparse;
+    skString        m_diffPath;
+    skString        m_reversePath;
+    bool            m_pager;
+    SKuint32        m_view;
+    bool            m_bigEndian;
+    SKuint32        m_threads;
+    RecordTemplate* m_template;
+    skString        m_columnPrefix;
+    SKsize          m_begin;
+    SKsize          m_end;
+    MappedFile      m_left;
+    MappedFile      m_right;
+
+    // Lines held back as leading context in --context mode
+    SKuint8*        m_ring;
+    SKuint64*       m_ringAddress;
+    SKuint32*       m_ringLength;
+    SKint32         m_ringStart;
+    SKint32         m_ringSize;
+    SKint32         m_after;
+    SKuint64        m_nextLine;
 
 public:
     Application() :
-        m_code(-1),
         m_addressRange(),
         m_flags(PF_DEFAULT | PF_FULLADDR),
-        m_csv(false)
+        m_width(16),
+        m_context(-1),
+        m_csv(false),
+        m_column(0),
+        m_squeeze(false),
+        m_squeezed(false),
+        m_pager(false),
+        m_view(WT_MAX),
+        m_bigEndian(false),
+        m_threads(1),
+        m_template(nullptr),
+        m_begin(0),
+        m_end(0),
+        m_ring(nullptr),
+        m_ringAddress(nullptr),
+        m_ringLength(nullptr),
+        m_ringStart(0),
+        m_ringSize(0),
+        m_after(0),
+        m_nextLine(SK_NPOS)
     {
         m_addressRange[0] = SK_NPOS32;
         m_addressRange[1] = SK_NPOS32;
@@ -111,6 +301,10 @@ public:
 
     ~Application()
     {
+        delete m_template;
+        delete[] m_ring;
+        delete[] m_ringAddress;
+        delete[] m_ringLength;
     }
 
     int parse(int argc, char **argv)
@@ -123,18 +317,97 @@ public:
             m_flags = psr.getValueInt(HP_FLAGS, 0, PF_DEFAULT | PF_FULLADDR, 10);
 
         if (psr.isPresent(HP_MARK))
-            m_code = psr.getValueInt64(HP_MARK, 0, SK_NPOS, 16);
+        {
+            skString list = psr.getValueString(HP_MARK, 0);
+
+            char* tok = strtok((char*)list.c_str(), ", ");
+            while (tok)
+            {
+                if (!m_search.add(tok))
+                {
+                    skLogf(LD_ERROR, "Invalid mark sequence '%s'\n", tok);
+                    return 1;
+                }
+                tok = strtok(nullptr, ", ");
+            }
+        }
+
+        if (psr.isPresent(HP_GREP))
+        {
+            if (m_search.empty())
+            {
+                skLogf(LD_ERROR, "--context requires at least one --mark sequence\n");
+                return 1;
+            }
+            m_context = skClamp(psr.getValueInt(HP_GREP, 0, 0), 0, 1024);
+        }
 
         if (psr.isPresent(HP_NOCOLOR))
             m_flags &= ~PF_COLORIZE;
 
         m_csv = psr.isPresent(HP_CSV);
+        if (psr.isPresent(HP_EMBED))
+        {
+            m_embed = psr.getValueString(HP_EMBED, 0);
+            if (!isIdentifier(m_embed.c_str()))
+            {
+                skLogf(LD_ERROR, "Invalid array name '%s'\n", m_embed.c_str());
+                return 1;
+            }
+            m_csv = true;
+        }
+
+        if (psr.isPresent(HP_WIDTH))
+        {
+            m_width = psr.getValueInt(HP_WIDTH, 0, 16);
+            if (m_csv)
+                m_width = skClamp<SKuint32>(m_width, 1, 256);
+            else if (m_width != 16 && m_width != 32 && m_width != 64)
+            {
+                skLogf(LD_ERROR, "Invalid width %u, expected 16, 32 or 64\n", m_width);
+                return 1;
+            }
+        }
+
+        m_squeeze = psr.isPresent(HP_SQUEEZE);
         if (psr.isPresent(HP_RANGE))
         {
             m_addressRange[0] = psr.getValueInt(HP_RANGE, 0, SK_NPOS32, 16);
             m_addressRange[1] = psr.getValueInt(HP_RANGE, 1, SK_NPOS32, 10);
         }
 
+        if (psr.isPresent(HP_DIFF))
+            m_diffPath = psr.getValueString(HP_DIFF, 0);
+
+        if (psr.isPresent(HP_REVERSE))
+            m_reversePath = psr.getValueString(HP_REVERSE, 0);
+
+        m_pager = psr.isPresent(HP_PAGER);
+
+        if (psr.isPresent(HP_THREADS))
+            m_threads = (SKuint32)skClamp(psr.getValueInt(HP_THREADS, 0, 1), 0, 256);
+
+        if (psr.isPresent(HP_TEMPLATE))
+        {
+            m_template = new RecordTemplate();
+            if (!m_template->load(psr.getValueString(HP_TEMPLATE, 0).c_str()))
+                return 1;
+
+            if (psr.isPresent(HP_COLUMNS))
+                m_columnPrefix = psr.getValueString(HP_COLUMNS, 0);
+        }
+
+        if (psr.isPresent(HP_VIEW))
+        {
+            m_view = WordFormatter::findType(psr.getValueString(HP_VIEW, 0).c_str());
+            if (m_view == WT_MAX)
+            {
+                skLogf(LD_ERROR, "Unknown view '%s'\n", psr.getValueString(HP_VIEW, 0).c_str());
+                return 1;
+            }
+            m_bigEndian = psr.isPresent(HP_BIG_ENDIAN);
+        }
+
         using StringArray = Parser::StringArray;
         StringArray &args = psr.getArgList();
         if (args.empty())
@@ -149,31 +422,557 @@ public:
             skLogf(LD_ERROR, "Failed to open file %s\n", args[0].c_str());
             return 1;
         }
+
+        // Holes are only skipped when they can be squeezed, and when
+        // no --mark sequence could match the zeros.
+        if (m_squeeze && !m_csv && m_search.empty())
+            m_sparse.open(args[0].c_str());
+
+        if (!m_diffPath.empty() || !m_reversePath.empty() || m_pager)
+        {
+            if (!m_left.open(args[0].c_str()))
+            {
+                skLogf(LD_ERROR, "Failed to map file %s\n", args[0].c_str());
+                return 1;
+            }
+
+            if (!m_diffPath.empty() && !m_right.open(m_diffPath.c_str()))
+            {
+                skLogf(LD_ERROR, "Failed to map file %s\n", m_diffPath.c_str());
+                return 1;
+            }
+        }
+        else if (m_threads != 1 && !m_squeeze && m_context < 0)
+        {
+            // The pipeline formats chunks out of order, so it reads from a
+            // mapping, and falls back to reading in order when that fails.
+            // --squeeze and --context depend on the previous line.
+            m_left.open(args[0].c_str());
+        }
         return 0;
     }
 
-    void dumpCSV(const void * ptr,
-                 const SKsize offset,
-                 const SKsize len)
+    static bool isIdentifier(const char* str)
+    {
+        if (!str || !(isalpha((unsigned char)*str) || *str == '_'))
+            return false;
+
+        while (*++str)
+        {
+            if (!(isalnum((unsigned char)*str) || *str == '_'))
+                return false;
+        }
+        return true;
+    }
+
+    // Writes comma separated cells, column carries
+    // the position in the line from one chunk to the next.
+    void writeArray(OutputBuffer& out, const SKuint8* data, SKsize len, SKuint32& column) const
     {
-        if (!ptr || offset == SK_NPOS || len == SK_NPOS)
+        const SKsize lineSize = (SKsize)m_width * HexFormatter::ArrayCellSize + 3;
+
+        while (len > 0)
+        {
+            const SKsize n = skMin<SKsize>(m_width - column, len);
+
+            char*  dest = out.reserve(lineSize);
+            SKsize size = HexFormatter::formatArray(dest, data, n);
+
+            column += (SKuint32)n;
+            if (column == m_width)
+            {
+                dest[size++] = '\n';
+                column       = 0;
+            }
+            out.commit(size);
+
+            data += n;
+            len -= n;
+        }
+    }
+
+    void writeLine(OutputBuffer&       out,
+                   const HexFormatter& fmt,
+                   const SKuint8*      data,
+                   SKuint32            len,
+                   SKuint64            address,
+                   const SKuint8*      marks)
+    {
+        const bool continues = m_nextLine == address;
+
+        if (m_squeeze && continues && len == m_width &&
+            (!marks || !memchr(marks, 1, len)) &&
+            memcmp(data, m_previous, len) == 0)
+        {
+            if (!m_squeezed)
+                out.write("*\n", 2);
+            m_squeezed = true;
+            m_nextLine = address + len;
             return;
-        SKsize      i, j;
-        const char *cp = (const char *)ptr;
-        for (i = 0; i < len; i += 16)
+        }
+
+        if (m_nextLine != SK_NPOS && !continues)
+            out.write("--\n", 3);
+
+        char* dest = out.reserve(fmt.getLineSize());
+        out.commit(fmt.formatLine(dest, data, len, address, marks));
+        m_nextLine = address + len;
+
+        if (m_squeeze)
+        {
+            memcpy(m_previous, data, len);
+            m_squeezed = false;
+        }
+    }
+
+    // Squeezes len bytes at once when every line of it repeats the last line.
+    bool squeezeLines(OutputBuffer&  out,
+                      const SKuint8* data,
+                      SKsize         len,
+                      SKuint64       address,
+                      const SKuint8* marks)
+    {
+        if (m_nextLine != address || len == 0 || len % m_width != 0)
+            return false;
+        if (marks && memchr(marks, 1, len))
+            return false;
+
+        if (memcmp(data, m_previous, m_width) != 0 ||
+            memcmp(data, data + m_width, len - m_width) != 0)
+            return false;
+
+        if (!m_squeezed)
+            out.write("*\n", 2);
+        m_squeezed = true;
+        m_nextLine = address + len;
+        return true;
+    }
+
+    // Writes a run of zeros without reading it.
+    void writeHole(OutputBuffer& out, const HexFormatter& fmt, SKsize len, SKuint64 address)
+    {
+        static const SKuint8 Zeros[HexFormatter::MaxWidth] = {};
+
+        writeLine(out, fmt, Zeros, m_width, address, nullptr);
+        if (len > m_width && !m_squeezed)
+        {
+            out.write("*\n", 2);
+            m_squeezed = true;
+        }
+        m_nextLine = address + len;
+    }
+
+    // Prints a line in --context mode. Lines without a match are kept in a
+    // ring of m_context lines so they can be printed if a match follows.
+    void grepLine(OutputBuffer&       out,
+                  const HexFormatter& fmt,
+                  const SKuint8*      data,
+                  SKuint32            len,
+                  SKuint64            address,
+                  const SKuint8*      marks)
+    {
+        if (memchr(marks, 1, len))
+        {
+            for (SKint32 i = 0; i < m_ringSize; ++i)
+            {
+                const SKint32 j = (m_ringStart + i) % m_context;
+                const SKsize  o = (SKsize)j * m_width;
+
+                writeLine(out, fmt, m_ring + o, m_ringLength[j], m_ringAddress[j], nullptr);
+            }
+            m_ringStart = m_ringSize = 0;
+
+            writeLine(out, fmt, data, len, address, marks);
+            m_after = m_context;
+        }
+        else if (m_after > 0)
+        {
+            writeLine(out, fmt, data, len, address, marks);
+            --m_after;
+        }
+        else if (m_context > 0)
+        {
+            SKint32 j;
+            if (m_ringSize < m_context)
+                j = (m_ringStart + m_ringSize++) % m_context;
+            else
+            {
+                j           = m_ringStart;
+                m_ringStart = (m_ringStart + 1) % m_context;
+            }
+
+            memcpy(m_ring + (SKsize)j * m_width, data, len);
+            m_ringLength[j]  = len;
+            m_ringAddress[j] = address;
+        }
+    }
+
+    void writeLines(OutputBuffer&       out,
+                    const HexFormatter& fmt,
+                    const SKuint8*      data,
+                    SKsize              len,
+                    SKuint64            address,
+                    const SKuint8*      marks)
+    {
+        if (m_context < 0 && !m_squeeze)
+            fmt.format(out, data, len, address, marks);
+        else if (m_context < 0)
+        {
+            if (squeezeLines(out, data, len, address, marks))
+                return;
+
+            for (SKsize i = 0; i < len; i += m_width)
+            {
+                const SKuint32 n = (SKuint32)skMin<SKsize>(m_width, len - i);
+                writeLine(out, fmt, data + i, n, address + i, marks ? marks + i : nullptr);
+            }
+        }
+        else
+        {
+            for (SKsize i = 0; i < len; i += m_width)
+            {
+                const SKuint32 n = (SKuint32)skMin<SKsize>(m_width, len - i);
+                grepLine(out, fmt, data + i, n, address + i, marks + i);
+            }
+        }
+    }
+
+    void writeIdentical(OutputBuffer& out, SKsize from, SKsize to)
+    {
+        if (to > from)
         {
-            for (j = 0; j < 16; j++)
+            out.print("%0*llX  * %llu identical bytes\n",
+                      m_flags & PF_FULLADDR ? 16 : 8,
+                      (unsigned long long)from,
+                      (unsigned long long)(to - from));
+        }
+    }
+
+    // Compares both mappings a block at a time, skipping blocks that are
+    // equal. Lines that differ are printed side by side with the differing
+    // bytes marked, and the runs between them are collapsed.
+    int diff()
+    {
+        const SKuint8* lp = m_left.getData();
+        const SKuint8* rp = m_right.getData();
+        const SKsize   ln = m_left.getSize();
+        const SKsize   rn = m_right.getSize();
+
+        SKsize a = 0, end = skMax(ln, rn);
+        if (m_addressRange[0] != SK_NPOS32)
+        {
+            a   = skMin<SKsize>(m_addressRange[0], end);
+            end = skMin<SKsize>(end, a + m_addressRange[1]);
+        }
+        const SKsize common = skClamp(skMin(ln, rn), a, end);
+
+        OutputBuffer out;
+        HexFormatter left(m_flags, m_width);
+        HexFormatter right(m_flags & ~PF_ADDRESS, m_width);
+        SKuint8      marks[HexFormatter::MaxWidth];
+
+        SKsize i = a, same = a, lines = 0;
+        while (i < end)
+        {
+            if (i + DiffBlock <= common && memcmp(lp + i, rp + i, DiffBlock) == 0)
+            {
+                i += DiffBlock;
+                continue;
+            }
+
+            const SKuint32 n  = (SKuint32)skMin<SKsize>(m_width, end - i);
+            const SKuint32 lc = i < ln ? (SKuint32)skMin<SKsize>(n, ln - i) : 0;
+            const SKuint32 rc = i < rn ? (SKuint32)skMin<SKsize>(n, rn - i) : 0;
+
+            if (lc == n && rc == n && memcmp(lp + i, rp + i, n) == 0)
+            {
+                i += n;
+                continue;
+            }
+
+            writeIdentical(out, same, i);
+
+            for (SKuint32 k = 0; k < n; ++k)
+                marks[k] = k >= lc || k >= rc || lp[i + k] != rp[i + k];
+
+            char*  dest = out.reserve(left.getLineSize() + right.getLineSize() + 2);
+            SKsize size = left.formatColumns(dest, lp + i, lc, i, marks, true);
+
+            dest[size++] = ' ';
+            dest[size++] = ' ';
+            size += right.formatColumns(dest + size, rp + i, rc, i, marks, false);
+            dest[size++] = '\n';
+            out.commit(size);
+
+            i += n;
+            same = i;
+            ++lines;
+        }
+
+        writeIdentical(out, same, end);
+        return lines > 0 ? 1 : 0;
+    }
+
+    // Formats [offset, offset + len) of the mapping for the pipeline.
+    // Marks are found in a window that reaches one sequence length to
+    // either side, so matches across the chunk boundaries are kept.
+    static void formatChunk(void* user, SKsize offset, SKsize len, OutputBuffer& out)
+    {
+        const Application* app  = (const Application*)user;
+        const SKuint8*     data = app->m_left.getData();
+
+        if (app->m_template)
+            app->m_template->formatRecords(out, data + offset, len / app->m_template->getRecordSize());
+        else if (app->m_view != WT_MAX)
+        {
+            WordFormatter fmt(app->m_flags, app->m_width, app->m_view, app->m_bigEndian);
+            fmt.format(out, data + offset, len, offset);
+        }
+        else if (app->m_csv)
+        {
+            SKuint32 column = 0;
+            app->writeArray(out, data + offset, len, column);
+        }
+        else
+        {
+            HexFormatter fmt(app->m_flags, app->m_width);
+            if (app->m_search.empty())
+                fmt.format(out, data + offset, len, offset, nullptr);
+            else
+            {
+                const SKsize extra = (SKsize)app->m_search.getMaxLength() - 1;
+                const SKsize lo    = offset - skMin(offset - app->m_begin, extra);
+                const SKsize hi    = skMin(offset + len + extra, app->m_end);
+
+                SKuint8* marks = new SKuint8[hi - lo];
+                skMemset(marks, 0, hi - lo);
+                app->m_search.mark(marks, data + lo, hi - lo, 0);
+
+                fmt.format(out, data + offset, len, offset, marks + (offset - lo));
+                delete[] marks;
+            }
+        }
+    }
+
+    void formatParallel(OutputBuffer& out, SKsize begin, SKsize end)
+    {
+        m_begin = begin;
+        m_end   = end;
+
+        // chunks start on a line or record so each one formats whole ones
+        const SKsize unit = m_template ? m_template->getRecordSize() : m_width;
+
+        OrderedPipeline pipeline(m_threads, skMax<SKsize>(ChunkSize / unit, 1) * unit);
+        pipeline.run(begin, end, formatChunk, this, out);
+    }
+
+    int reverse()
+    {
+        // A regular file is written beside the target and renamed over it
+        // once the whole input has been read, so a failure leaves the target
+        // as it was. Devices and pipes are written directly.
+        struct stat st;
+
+        const char* dest   = m_reversePath.c_str();
+        const bool  direct = stat(dest, &st) == 0 && (st.st_mode & S_IFMT) != S_IFREG;
+
+        skString path = m_reversePath;
+        if (!direct)
+            path.append(".partial");
+
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (!fp)
+        {
+            skLogf(LD_ERROR, "Failed to open file %s\n", path.c_str());
+            return 1;
+        }
+
+        HexReader reader(fp);
+
+        bool result = reader.read((const char*)m_left.getData(), m_left.getSize());
+        result      = fclose(fp) == 0 && result;
+        if (direct)
+            return result ? 0 : 1;
+
+        if (result)
+        {
+#ifdef _WIN32
+            remove(dest);
+#endif
+            result = rename(path.c_str(), dest) == 0;
+            if (!result)
+                skLogf(LD_ERROR, "Failed to write file %s\n", dest);
+        }
+
+        if (!result)
+            remove(path.c_str());
+        return result ? 0 : 1;
+    }
+
+    int page()
+    {
+        SKsize a = 0, r = m_left.getSize();
+        if (m_addressRange[0] != SK_NPOS32)
+        {
+            a = skMin<SKsize>(m_addressRange[0], r);
+            r = skMin<SKsize>(m_addressRange[1], r - a);
+        }
+
+        Pager pager(m_left.getData() + a, r, a, m_flags, m_width, &m_search);
+        return pager.run();
+    }
+
+    int words()
+    {
+        SKsize a = 0, r = m_stream.size();
+        if (m_addressRange[0] != SK_NPOS32)
+        {
+            a = skMin<SKsize>(m_addressRange[0], r);
+            r = skMin<SKsize>(m_addressRange[1], r - a);
+            m_stream.seek(a, SEEK_SET);
+        }
+
+        OutputBuffer out;
+        if (m_left.isOpen())
+        {
+            formatParallel(out, a, a + r);
+            return 0;
+        }
+
+        SKuint8*      buffer = new SKuint8[ChunkSize];
+        WordFormatter fmt(m_flags, m_width, m_view, m_bigEndian);
+
+        SKsize br, tr = 0;
+        while (!m_stream.eof() && tr < r)
+        {
+            br = m_stream.read(buffer, skMin<SKsize>(ChunkSize, r - tr));
+            if (br == SK_NPOS32 || br == 0)
+                break;
+
+            fmt.format(out, buffer, br, a + tr);
+            tr += br;
+        }
+
+        delete[] buffer;
+        return 0;
+    }
+
+    // Writes the next r bytes of records in the stream as one binary
+    // file per column.
+    int columns(SKsize r)
+    {
+        const SKuint32  count   = m_template->getColumnCount();
+        const skString& names   = m_template->getNames();
+        OutputBuffer**  columns = new OutputBuffer*[count];
+        FILE**          files   = new FILE*[count];
+        SKuint32        open    = 0;
+
+        for (; open < count; ++open)
+        {
+            const RecordTemplate::Column& col = m_template->getColumn(open);
+
+            skString path = m_columnPrefix;
+            path.append('.');
+            path.append(names.c_str() + col.name, col.nameLength);
+            path.append(".bin");
+
+            files[open] = fopen(path.c_str(), "wb");
+            if (!files[open])
             {
-                const auto c = (unsigned char)cp[i + j];
-                printf("0x%02X, ", c);
+                skLogf(LD_ERROR, "Failed to open file %s\n", path.c_str());
+                break;
             }
-            printf("\n");
+            columns[open] = new OutputBuffer(files[open], 1 << 16);
+        }
+
+        if (open == count)
+        {
+            const SKsize size  = m_template->getRecordSize();
+            const SKsize chunk = skMax<SKsize>(ChunkSize / size, 1) * size;
+
+            SKuint8* buffer = new SKuint8[chunk];
+
+            SKsize br, tr = 0;
+            while (!m_stream.eof() && tr < r)
+            {
+                br = m_stream.read(buffer, skMin(chunk, r - tr));
+                if (br == SK_NPOS32 || br == 0)
+                    break;
+
+                m_template->formatColumns(columns, buffer, br / size);
+                tr += br;
+            }
+            delete[] buffer;
+        }
+
+        for (SKuint32 i = 0; i < open; ++i)
+        {
+            delete columns[i];
+            fclose(files[i]);
         }
+
+        delete[] files;
+        delete[] columns;
+        return open == count ? 0 : 1;
+    }
+
+    // Decodes the whole records in the range with the --template layout.
+    int records()
+    {
+        SKsize a = 0, r = m_stream.size();
+        if (m_addressRange[0] != SK_NPOS32)
+        {
+            a = skMin<SKsize>(m_addressRange[0], r);
+            r = skMin<SKsize>(m_addressRange[1], r - a);
+            m_stream.seek(a, SEEK_SET);
+        }
+
+        // a trailing partial record is skipped
+        const SKsize size = m_template->getRecordSize();
+        r -= r % size;
+
+        if (!m_columnPrefix.empty())
+            return columns(r);
+
+        OutputBuffer out;
+        m_template->writeHeader(out);
+
+        if (m_left.isOpen())
+        {
+            formatParallel(out, a, a + r);
+            return 0;
+        }
+
+        const SKsize chunk  = skMax<SKsize>(ChunkSize / size, 1) * size;
+        SKuint8*     buffer = new SKuint8[chunk];
+
+        SKsize br, tr = 0;
+        while (!m_stream.eof() && tr < r)
+        {
+            br = m_stream.read(buffer, skMin(chunk, r - tr));
+            if (br == SK_NPOS32 || br == 0)
+                break;
+
+            m_template->formatRecords(out, buffer, br / size);
+            tr += br;
+        }
+
+        delete[] buffer;
+        return 0;
     }
 
     int print()
     {
-        SKuint8 buffer[1025];
+        if (!m_reversePath.empty())
+            return reverse();
+        if (m_template)
+            return records();
+        if (m_view != WT_MAX)
+            return words();
+        if (m_pager)
+            return page();
+        if (!m_diffPath.empty())
+            return diff();
 
         SKsize n;
         SKsize a, r;
@@ -189,20 +988,127 @@ public:
             r = n;
         }
 
-        SKsize br, tr = 0;
+        OutputBuffer out;
+        if (!m_embed.empty())
+        {
+            if (r == 0)
+            {
+                // a zero length array is not valid C++
+                out.print("const unsigned char %s[1] = {0x00};\n", m_embed.c_str());
+                out.print("const unsigned int %s_size = 0;\n", m_embed.c_str());
+                return 0;
+            }
+            out.print("const unsigned char %s[] = {\n", m_embed.c_str());
+        }
+
+        if (m_left.isOpen())
+        {
+            formatParallel(out, a, skMin(a + r, n));
+            if (m_csv && (skMin(a + r, n) - a) % m_width != 0)
+                out.write("\n", 1);
+            if (!m_embed.empty())
+            {
+                out.print("};\n");
+                out.print("const unsigned int %s_size = sizeof(%s);\n", m_embed.c_str(), m_embed.c_str());
+            }
+            return 0;
+        }
+
+        // The last lines of each chunk are held back until the next chunk
+        // is searched so that matches across the boundary are marked.
+        SKsize hold = 0;
+        if (!m_search.empty() && !m_csv)
+        {
+            hold = (SKsize)m_search.getMaxLength() - 1;
+            hold = (hold + m_width - 1) / m_width * m_width;
+        }
+
+        SKuint8* buffer = new SKuint8[hold + m_width + ChunkSize + 1];
+        SKuint8* marks  = hold || !m_search.empty() ? new SKuint8[hold + m_width + ChunkSize] : nullptr;
+
+        if (m_context > 0)
+        {
+            m_ring        = new SKuint8[(SKsize)m_context * m_width];
+            m_ringAddress = new SKuint64[m_context];
+            m_ringLength  = new SKuint32[m_context];
+        }
+
+        HexFormatter fmt(m_flags, m_csv ? (SKuint32)HexFormatter::MinWidth : m_width);
+
+        SKsize br, tr = 0, held = 0;
         while (!m_stream.eof() && tr < r)
         {
-            br = m_stream.read(buffer, skMin<SKsize>(1024, r));
-            if (br != SK_NPOS32 && br > 0)
+            SKsize want = skMin<SKsize>(ChunkSize, r - tr);
+
+            if (m_squeeze && !m_csv)
+            {
+                const SKsize pos  = a + tr;
+                SKsize       hole = m_sparse.nextData(pos, a + r) - pos;
+
+                hole -= hole % m_width;
+                if (hole > 0)
+                {
+                    writeHole(out, fmt, hole, pos);
+                    tr += hole;
+                    m_stream.seek(a + tr, SEEK_SET);
+                    continue;
+                }
+
+                // stop the read at the next hole, on a line boundary
+                SKsize data = m_sparse.nextHole(pos, a + r) - pos;
+
+                data = (data + m_width - 1) / m_width * m_width;
+                want = skClamp<SKsize>(data, m_width, want);
+            }
+
+            br = m_stream.read(buffer + held, want);
+            if (br == SK_NPOS32 || br == 0)
+                break;
+
+            buffer[held + br] = 0;
+            if (m_csv)
             {
-                buffer[br] = 0;
-                if (m_csv)
-                    dumpCSV(buffer, tr + a, br);
-                else
-                    dumpHex(buffer, tr + a, br, m_flags, m_code);
+                writeArray(out, buffer, br, m_column);
                 tr += br;
+                continue;
+            }
+
+            const SKsize len = held + br;
+            if (marks)
+            {
+                skMemset(marks + held, 0, br);
+                m_search.mark(marks, buffer, len, held);
             }
+
+            // everything but the new hold is final
+            const SKsize done = len > hold ? (len - hold) / m_width * m_width : 0;
+            writeLines(out, fmt, buffer, done, a + tr - held, marks);
+
+            held = len - done;
+            memmove(buffer, buffer + done, held);
+            if (marks)
+                memmove(marks, marks + done, held);
+            tr += br;
+        }
+
+        if (held > 0)
+            writeLines(out, fmt, buffer, held, a + tr - held, marks);
+
+        if (m_csv && m_column > 0)
+            out.write("\n", 1);
+
+        if (!m_embed.empty())
+        {
+            out.print("};\n");
+            out.print("const unsigned int %s_size = sizeof(%s);\n", m_embed.c_str(), m_embed.c_str());
         }
+
+        // a squeezed run at the end hides the size, so the last address is written
+        if (m_squeezed)
+            out.print("%0*llX\n", m_flags & PF_FULLADDR ? 16 : 8, (unsigned long long)m_nextLine);
+
+        delete[] marks;
+        delete[] buffer;
         return 0;
     }
 };
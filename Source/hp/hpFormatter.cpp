@@ -0,0 +1,296 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "hpFormatter.h"
+#include "Utils/skHexPrint.h"
+#include "Utils/skMemoryUtils.h"
+#include "outputBuffer.h"
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define HP_FORMAT_SSSE3
+#include <tmmintrin.h>
+#endif
+
+using namespace skHexPrint;
+
+namespace
+{
+    const char HexDigits[] = "0123456789ABCDEF";
+
+    const char   MarkOn[]     = "\x1b[1;31m";
+    const char   MarkOff[]    = "\x1b[0m";
+    const SKsize MarkOnSize   = sizeof MarkOn - 1;
+    const SKsize MarkOffSize  = sizeof MarkOff - 1;
+    const SKsize MarkSize     = MarkOnSize + MarkOffSize;
+    const SKsize AddressSize  = 16 + 2;
+    const SKsize StoreOverrun = 16;
+
+    class FormatTables
+    {
+    public:
+        // "XX " followed by a pad byte so that cells can be copied as words.
+        char cells[256][4];
+        char ascii[256];
+
+        // "0xXX, " padded to eight bytes
+        char array[256][8];
+
+        FormatTables()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                cells[i][0] = HexDigits[i >> 4];
+                cells[i][1] = HexDigits[i & 15];
+                cells[i][2] = ' ';
+                cells[i][3] = ' ';
+                ascii[i]    = i >= 32 && i < 127 ? (char)i : '.';
+
+                memcpy(array[i], "0x00,   ", 8);
+                array[i][2] = HexDigits[i >> 4];
+                array[i][3] = HexDigits[i & 15];
+            }
+        }
+    };
+
+    const FormatTables Tables;
+
+#ifdef HP_FORMAT_SSSE3
+
+    // Writes 16 bytes as two groups of eight "XX " cells,
+    // each followed by the group separator.
+    SK_INLINE char* formatHex16(char* dest, const SKuint8* src)
+    {
+        const __m128i lut  = _mm_loadu_si128((const __m128i*)HexDigits);
+        const __m128i low  = _mm_set1_epi8(0x0F);
+        const __m128i v    = _mm_loadu_si128((const __m128i*)src);
+        const __m128i hi   = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+        const __m128i lo   = _mm_shuffle_epi8(lut, _mm_and_si128(v, low));
+        const __m128i ga   = _mm_unpacklo_epi8(hi, lo);
+        const __m128i gb   = _mm_unpackhi_epi8(hi, lo);
+        const __m128i s0   = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+        const __m128i s1   = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+        const __m128i sp   = _mm_set1_epi8(' ');
+        const __m128i sp0  = _mm_and_si128(s0, sp);
+        const __m128i sp1  = _mm_and_si128(s1, sp);
+
+        _mm_storeu_si128((__m128i*)dest, _mm_or_si128(_mm_shuffle_epi8(ga, s0), sp0));
+        _mm_storeu_si128((__m128i*)(dest + 16), _mm_or_si128(_mm_shuffle_epi8(ga, s1), sp1));
+        _mm_storeu_si128((__m128i*)(dest + 25), _mm_or_si128(_mm_shuffle_epi8(gb, s0), sp0));
+        _mm_storeu_si128((__m128i*)(dest + 41), _mm_or_si128(_mm_shuffle_epi8(gb, s1), sp1));
+        return dest + 50;
+    }
+
+    SK_INLINE char* formatAscii16(char* dest, const SKuint8* src)
+    {
+        const __m128i v  = _mm_loadu_si128((const __m128i*)src);
+        const __m128i pr = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1F)),
+                                         _mm_cmplt_epi8(v, _mm_set1_epi8(0x7F)));
+
+        _mm_storeu_si128((__m128i*)dest,
+                         _mm_or_si128(_mm_and_si128(pr, v),
+                                      _mm_andnot_si128(pr, _mm_set1_epi8('.'))));
+        return dest + 16;
+    }
+
+#endif
+
+    SK_INLINE bool hasMarks(const SKuint8* marks, SKuint32 len)
+    {
+        if (!marks)
+            return false;
+
+        SKuint8 r = 0;
+        for (SKuint32 i = 0; i < len; ++i)
+            r |= marks[i];
+        return r != 0;
+    }
+}  // namespace
+
+HexFormatter::HexFormatter(SKuint32 flags, SKuint32 width) :
+    m_flags(flags),
+    m_width(skClamp<SKuint32>(width, MinWidth, MaxWidth) & ~(SKuint32)15)
+{
+    // Every byte may be wrapped in a mark in both columns, and the
+    // SIMD stores may write past the last byte of the line.
+    m_lineSize = AddressSize + 4 * m_width + m_width / 8 + 3;
+    m_lineSize += 2 * m_width * MarkSize + StoreOverrun;
+}
+
+char* HexFormatter::formatAddress(char* dest, SKuint64 address) const
+{
+    int digits = m_flags & PF_FULLADDR ? 16 : 8;
+    while (digits-- > 0)
+        *dest++ = HexDigits[(address >> (digits * 4)) & 15];
+
+    *dest++ = ' ';
+    *dest++ = ' ';
+    return dest;
+}
+
+char* HexFormatter::formatHex(char* dest, const SKuint8* data, SKuint32 len, const SKuint8* marks) const
+{
+    SKuint32 i = 0;
+    if (!marks)
+    {
+#ifdef HP_FORMAT_SSSE3
+        for (; i + 16 <= len; i += 16)
+            dest = formatHex16(dest, data + i);
+#endif
+        for (; i < len; ++i)
+        {
+            memcpy(dest, Tables.cells[data[i]], 4);
+            dest += (i & 7) == 7 ? 4 : 3;
+        }
+    }
+    else
+    {
+        bool on = false;
+        for (; i < len; ++i)
+        {
+            if (marks[i] && !on)
+            {
+                memcpy(dest, MarkOn, MarkOnSize);
+                dest += MarkOnSize;
+                on = true;
+            }
+
+            *dest++ = Tables.cells[data[i]][0];
+            *dest++ = Tables.cells[data[i]][1];
+
+            if (on && ((i & 7) == 7 || i + 1 == len || !marks[i + 1]))
+            {
+                memcpy(dest, MarkOff, MarkOffSize);
+                dest += MarkOffSize;
+                on = false;
+            }
+
+            *dest++ = ' ';
+            if ((i & 7) == 7)
+                *dest++ = ' ';
+        }
+    }
+
+    // pad short lines so that the ASCII column stays aligned
+    for (; i < m_width; ++i)
+    {
+        memcpy(dest, "    ", 4);
+        dest += (i & 7) == 7 ? 4 : 3;
+    }
+    return dest;
+}
+
+char* HexFormatter::formatAscii(char* dest, const SKuint8* data, SKuint32 len, const SKuint8* marks) const
+{
+    SKuint32 i = 0;
+
+    *dest++ = '|';
+    if (!marks)
+    {
+#ifdef HP_FORMAT_SSSE3
+        for (; i + 16 <= len; i += 16)
+            dest = formatAscii16(dest, data + i);
+#endif
+        for (; i < len; ++i)
+            *dest++ = Tables.ascii[data[i]];
+    }
+    else
+    {
+        for (; i < len; ++i)
+        {
+            if (marks[i] && (i == 0 || !marks[i - 1]))
+            {
+                memcpy(dest, MarkOn, MarkOnSize);
+                dest += MarkOnSize;
+            }
+
+            *dest++ = Tables.ascii[data[i]];
+
+            if (marks[i] && (i + 1 == len || !marks[i + 1]))
+            {
+                memcpy(dest, MarkOff, MarkOffSize);
+                dest += MarkOffSize;
+            }
+        }
+    }
+    *dest++ = '|';
+    return dest;
+}
+
+SKsize HexFormatter::formatColumns(char*          dest,
+                                   const SKuint8* data,
+                                   SKuint32       len,
+                                   SKuint64       address,
+                                   const SKuint8* marks,
+                                   bool           pad) const
+{
+    char* const start = dest;
+
+    len = skMin(len, m_width);
+    if (!(m_flags & PF_COLORIZE) || !hasMarks(marks, len))
+        marks = nullptr;
+
+    if (m_flags & PF_ADDRESS)
+        dest = formatAddress(dest, address);
+    if (m_flags & PF_HEX)
+        dest = formatHex(dest, data, len, marks);
+    if (m_flags & PF_ASCII)
+    {
+        dest = formatAscii(dest, data, len, marks);
+        if (pad && len < m_width)
+        {
+            skMemset(dest, ' ', m_width - len);
+            dest += m_width - len;
+        }
+    }
+    return (SKsize)(dest - start);
+}
+
+SKsize HexFormatter::formatLine(char*          dest,
+                                const SKuint8* data,
+                                SKuint32       len,
+                                SKuint64       address,
+                                const SKuint8* marks) const
+{
+    const SKsize size = formatColumns(dest, data, len, address, marks, false);
+
+    dest[size] = '\n';
+    return size + 1;
+}
+
+void HexFormatter::format(OutputBuffer&  out,
+                          const SKuint8* data,
+                          SKsize         len,
+                          SKuint64       address,
+                          const SKuint8* marks) const
+{
+    for (SKsize i = 0; i < len; i += m_width)
+    {
+        const SKuint32 n = (SKuint32)skMin<SKsize>(m_width, len - i);
+
+        char* dest = out.reserve(m_lineSize);
+        out.commit(formatLine(dest, data + i, n, address + i, marks ? marks + i : nullptr));
+    }
+}
+
+SKsize HexFormatter::formatArray(char* dest, const SKuint8* data, SKsize len)
+{
+    for (SKsize i = 0; i < len; ++i)
+        memcpy(dest + i * ArrayCellSize, Tables.array[data[i]], 8);
+    return len * ArrayCellSize;
+}
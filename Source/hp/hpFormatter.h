@@ -0,0 +1,97 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _hpFormatter_h_
+#define _hpFormatter_h_
+
+#include "Utils/skString.h"
+
+class OutputBuffer;
+
+// Converts whole lines of bytes into the address, hex and ASCII columns.
+// Lines without marks are converted 16 bytes at a time with SIMD shuffles
+// when the target supports them, otherwise through lookup tables.
+class HexFormatter
+{
+public:
+    enum
+    {
+        MinWidth = 16,
+        MaxWidth = 64,
+
+        // The size of one 0xXX, cell. formatArray may write
+        // two bytes past the last cell.
+        ArrayCellSize = 6,
+    };
+
+private:
+    SKuint32 m_flags;
+    SKuint32 m_width;
+    SKsize   m_lineSize;
+
+    char* formatAddress(char* dest, SKuint64 address) const;
+
+    char* formatHex(char* dest, const SKuint8* data, SKuint32 len, const SKuint8* marks) const;
+
+    char* formatAscii(char* dest, const SKuint8* data, SKuint32 len, const SKuint8* marks) const;
+
+public:
+    // Width is the number of bytes per line, one of 16, 32 or 64.
+    HexFormatter(SKuint32 flags, SKuint32 width);
+
+    // Returns the number of bytes that formatLine may write.
+    SKsize getLineSize() const
+    {
+        return m_lineSize;
+    }
+
+    SKuint32 getWidth() const
+    {
+        return m_width;
+    }
+
+    // Writes the columns of a single line without the line ending. When pad
+    // is true, short lines are padded to the full width of the ASCII column.
+    SKsize formatColumns(char*          dest,
+                         const SKuint8* data,
+                         SKuint32       len,
+                         SKuint64       address,
+                         const SKuint8* marks,
+                         bool           pad) const;
+
+    // Writes a single line of at most width bytes to dest. When marks is not
+    // null it holds one flag per byte, and flagged bytes are colored.
+    SKsize formatLine(char*          dest,
+                      const SKuint8* data,
+                      SKuint32       len,
+                      SKuint64       address,
+                      const SKuint8* marks) const;
+
+    // Writes len bytes as comma separated 0xXX cells.
+    static SKsize formatArray(char* dest, const SKuint8* data, SKsize len);
+
+    // Writes len bytes as consecutive lines starting at address.
+    void format(OutputBuffer&  out,
+                const SKuint8* data,
+                SKsize         len,
+                SKuint64       address,
+                const SKuint8* marks) const;
+};
+
+#endif  //_hpFormatter_h_
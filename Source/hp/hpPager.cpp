@@ -0,0 +1,493 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "hpPager.h"
+#include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
+#include "hpSearch.h"
+#include "outputBuffer.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+const SKsize SearchBlock = 1 << 20;
+
+enum PagerKeys
+{
+    PK_NONE = 0,
+    PK_UP   = 256,
+    PK_DOWN,
+    PK_PAGE_UP,
+    PK_PAGE_DOWN,
+    PK_HOME,
+    PK_END,
+    PK_ESCAPE,
+};
+
+Pager::Pager(const SKuint8*       data,
+             SKsize               size,
+             SKuint64             base,
+             SKuint32             flags,
+             SKuint32             width,
+             const PatternSearch* search) :
+    m_data(data),
+    m_size(size),
+    m_base(base),
+    m_fmt(flags, width),
+    m_search(search),
+    m_top(0),
+    m_match(SK_NPOS),
+    m_rows(24),
+    m_columns(80),
+    m_marks(nullptr),
+    m_result(SK_NPOS),
+    m_searching(false),
+    m_cancel(false)
+{
+}
+
+Pager::~Pager()
+{
+    m_cancel = true;
+    if (m_worker.joinable())
+        m_worker.join();
+    delete[] m_marks;
+}
+
+bool Pager::resize()
+{
+#ifndef _WIN32
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 1)
+    {
+        if (m_marks && ws.ws_row == m_rows + 1 && ws.ws_col == m_columns)
+            return false;
+        m_rows    = ws.ws_row - 1;
+        m_columns = ws.ws_col;
+    }
+#endif
+
+    delete[] m_marks;
+    m_marks = new SKuint8[(SKsize)m_rows * m_fmt.getWidth() + 2 * m_search->getMaxLength()];
+
+    moveTo(m_top);
+    return true;
+}
+
+void Pager::scroll(SKint64 rows)
+{
+    const SKint64 offset = (SKint64)m_top + rows * (SKint64)m_fmt.getWidth();
+    moveTo(offset < 0 ? 0 : (SKsize)offset);
+}
+
+void Pager::moveTo(SKsize offset)
+{
+    const SKsize width = m_fmt.getWidth();
+    const SKsize page  = (SKsize)m_rows * width;
+
+    // the last page ends on the last row rather than scrolling past it
+    const SKsize last = m_size > 0 ? (m_size - 1) / width * width : 0;
+    const SKsize most = last + width > page ? last + width - page : 0;
+
+    m_top = skMin(offset - offset % width, most);
+}
+
+void Pager::drawStatus(OutputBuffer& out)
+{
+    char buf[128];
+    int  len = skSprintf(buf,
+                         sizeof buf,
+                         " %016llX / %016llX ",
+                         (unsigned long long)(m_base + m_top),
+                         (unsigned long long)(m_base + m_size));
+
+    out.print("\x1b[%d;1H\x1b[7m", m_rows + 1);
+    out.write(buf, (SKsize)len);
+
+    SKint32 used = len;
+    if (!m_status.empty())
+    {
+        const SKint32 n = skMin<SKint32>((SKint32)m_status.size(), skMax(m_columns - used, 0));
+        out.write(m_status.c_str(), (SKsize)n);
+        used += n;
+    }
+
+    while (used++ < m_columns)
+        out.write(" ", 1);
+    out.write("\x1b[0m", 4);
+}
+
+void Pager::draw(OutputBuffer& out)
+{
+    const SKsize width = m_fmt.getWidth();
+    const SKsize page  = skMin<SKsize>((SKsize)m_rows * width, m_size - m_top);
+
+    // Only the rows on screen are searched, with enough of
+    // either side to mark the sequences that cross the edges.
+    const SKuint8* marks = nullptr;
+    if (!m_search->empty() && page > 0)
+    {
+        const SKsize pad   = m_search->getMaxLength() - 1;
+        const SKsize start = m_top - skMin(m_top, pad);
+        const SKsize end   = skMin(m_size, m_top + page + pad);
+
+        skMemset(m_marks, 0, end - start);
+        m_search->mark(m_marks, m_data + start, end - start, 0);
+        marks = m_marks + (m_top - start);
+    }
+
+    out.write("\x1b[H", 3);
+    for (SKint32 row = 0; row < m_rows; ++row)
+    {
+        const SKsize offset = (SKsize)row * width;
+        if (offset < page)
+        {
+            const SKuint32 n = (SKuint32)skMin(width, page - offset);
+
+            char*  dest = out.reserve(m_fmt.getLineSize() + 4);
+            SKsize size = m_fmt.formatColumns(dest,
+                                              m_data + m_top + offset,
+                                              n,
+                                              m_base + m_top + offset,
+                                              marks ? marks + offset : nullptr,
+                                              false);
+            out.commit(size);
+        }
+        out.write("\x1b[K\r\n", 5);
+    }
+
+    drawStatus(out);
+    out.flush();
+}
+
+void Pager::search(SKsize from)
+{
+    const SKsize overlap = m_search->getMaxLength() - 1;
+
+    for (SKsize pos = from; pos < m_size && !m_cancel; pos += SearchBlock)
+    {
+        const SKsize len = skMin(SearchBlock + overlap, m_size - pos);
+        const SKsize rc  = m_search->find(m_data + pos, len);
+        if (rc != SK_NPOS)
+        {
+            m_result = pos + rc;
+            break;
+        }
+    }
+    m_searching = false;
+}
+
+void Pager::findNext()
+{
+    if (m_search->empty())
+    {
+        m_status = "no --mark sequences to search for";
+        return;
+    }
+    if (m_searching)
+        return;
+
+    // continue from the last match while it is still on screen
+    const SKsize page = (SKsize)m_rows * m_fmt.getWidth();
+
+    SKsize from = m_top;
+    if (m_match != SK_NPOS && m_match >= m_top && m_match < m_top + page)
+        from = m_match + 1;
+
+    if (m_worker.joinable())
+        m_worker.join();
+
+    m_result    = SK_NPOS;
+    m_cancel    = false;
+    m_searching = true;
+    m_status    = "searching, esc cancels";
+    m_worker    = std::thread(&Pager::search, this, from);
+}
+
+void Pager::finishSearch()
+{
+    m_worker.join();
+
+    if (m_cancel)
+        m_status = "search cancelled";
+    else if (m_result != SK_NPOS)
+    {
+        char buf[64];
+        m_match = m_result;
+        skSprintf(buf, sizeof buf, "match at %016llX", (unsigned long long)(m_base + m_match));
+        m_status = buf;
+        moveTo(m_match);
+    }
+    else
+        m_status = "no more matches";
+}
+
+#ifdef _WIN32
+
+bool Pager::prompt(OutputBuffer&, skString&)
+{
+    return false;
+}
+
+int Pager::run()
+{
+    skLogf(LD_ERROR, "The interactive view is not available on this platform\n");
+    return 1;
+}
+
+#else
+
+namespace
+{
+    const int QuitSignals[] = {SIGINT, SIGTERM, SIGHUP};
+    const int QuitCount     = sizeof QuitSignals / sizeof QuitSignals[0];
+
+    volatile sig_atomic_t Quit = 0;
+
+    void onQuit(int)
+    {
+        Quit = 1;
+    }
+
+    // Raw input on the alternate screen with a hidden cursor and no line
+    // wrapping. ISIG is cleared so ^C and ^Z arrive as keys, and quit
+    // signals only set a flag, so every way out of Pager::run goes
+    // through the destructor and the terminal is always put back.
+    class TerminalMode
+    {
+    private:
+        OutputBuffer&    m_out;
+        struct termios   m_saved;
+        struct sigaction m_actions[QuitCount];
+
+    public:
+        explicit TerminalMode(OutputBuffer& out) :
+            m_out(out)
+        {
+            struct sigaction action;
+            memset(&action, 0, sizeof action);
+            action.sa_handler = onQuit;
+            sigemptyset(&action.sa_mask);
+
+            Quit = 0;
+            for (int i = 0; i < QuitCount; ++i)
+                sigaction(QuitSignals[i], &action, &m_actions[i]);
+
+            tcgetattr(STDIN_FILENO, &m_saved);
+
+            struct termios raw = m_saved;
+            raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+            raw.c_iflag &= ~(IXON | ICRNL);
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+            m_out.print("\x1b[?1049h\x1b[?25l\x1b[?7l");
+        }
+
+        ~TerminalMode()
+        {
+            m_out.print("\x1b[?7h\x1b[?25h\x1b[?1049l");
+            m_out.flush();
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &m_saved);
+
+            for (int i = 0; i < QuitCount; ++i)
+                sigaction(QuitSignals[i], &m_actions[i], nullptr);
+        }
+    };
+
+    unsigned char Pending[64];
+    SKsize        PendingSize = 0;
+
+    int takeKey(SKsize n, int key)
+    {
+        PendingSize -= n;
+        memmove(Pending, Pending + n, PendingSize);
+        return key;
+    }
+
+    // Waits up to timeout milliseconds for a key. Bytes that arrive
+    // together, such as pasted text, are kept for the following calls.
+    int readKey(int timeout)
+    {
+        if (PendingSize == 0)
+        {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(STDIN_FILENO, &set);
+
+            struct timeval tv = {timeout / 1000, (timeout % 1000) * 1000};
+            if (select(STDIN_FILENO + 1, &set, nullptr, nullptr, &tv) <= 0)
+                return PK_NONE;
+
+            const ssize_t n = read(STDIN_FILENO, Pending, sizeof Pending);
+            if (n <= 0)
+                return PK_NONE;
+            PendingSize = (SKsize)n;
+        }
+
+        if (Pending[0] != 0x1B)
+            return takeKey(1, Pending[0]);
+        if (PendingSize == 1 || (Pending[1] != '[' && Pending[1] != 'O'))
+            return takeKey(1, PK_ESCAPE);
+        if (PendingSize == 2)
+            return takeKey(2, PK_NONE);
+
+        // ESC [ n ~ sequences carry one more byte
+        const SKsize size = Pending[2] >= '0' && Pending[2] <= '9' && PendingSize > 3 ? 4 : 3;
+        switch (Pending[2])
+        {
+        case 'A':
+            return takeKey(size, PK_UP);
+        case 'B':
+            return takeKey(size, PK_DOWN);
+        case 'H':
+        case '1':
+        case '7':
+            return takeKey(size, PK_HOME);
+        case 'F':
+        case '4':
+        case '8':
+            return takeKey(size, PK_END);
+        case '5':
+            return takeKey(size, PK_PAGE_UP);
+        case '6':
+            return takeKey(size, PK_PAGE_DOWN);
+        default:
+            return takeKey(size, PK_NONE);
+        }
+    }
+}  // namespace
+
+bool Pager::prompt(OutputBuffer& out, skString& dest)
+{
+    dest.resize(0);
+    for (;;)
+    {
+        out.print("\x1b[%d;1H\x1b[7m goto: %s\x1b[K\x1b[0m", m_rows + 1, dest.c_str());
+        out.flush();
+
+        const int key = readKey(1000);
+        if (key == PK_ESCAPE || key == 0x03 || Quit)
+            return false;
+        if (key == '\r' || key == '\n')
+            return !dest.empty();
+
+        if ((key == 127 || key == 8) && !dest.empty())
+            dest.resize(dest.size() - 1);
+        else if (key > 32 && key < 127 && dest.size() < 18)
+            dest.append((char)key);
+    }
+}
+
+int Pager::run()
+{
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+    {
+        skLogf(LD_ERROR, "The interactive view needs a terminal\n");
+        return 1;
+    }
+
+    OutputBuffer out(stdout, 1 << 16);
+    TerminalMode mode(out);
+
+    m_status = "q quit, : goto, n next match, g/G start/end";
+
+    bool     redraw = true;
+    skString input;
+    while (!Quit)
+    {
+        if (resize())
+            redraw = true;
+        if (!m_searching && m_worker.joinable())
+        {
+            finishSearch();
+            redraw = true;
+        }
+
+        if (redraw)
+            draw(out);
+        redraw = true;
+
+        const int key = readKey(50);
+        switch (key)
+        {
+        case 'q':
+        case 0x03:
+            Quit = 1;
+            break;
+        case 'j':
+        case '\r':
+        case PK_DOWN:
+            scroll(1);
+            break;
+        case 'k':
+        case PK_UP:
+            scroll(-1);
+            break;
+        case ' ':
+        case 'f':
+        case PK_PAGE_DOWN:
+            scroll(m_rows);
+            break;
+        case 'b':
+        case PK_PAGE_UP:
+            scroll(-m_rows);
+            break;
+        case 'g':
+        case PK_HOME:
+            moveTo(0);
+            break;
+        case 'G':
+        case PK_END:
+            moveTo(m_size);
+            break;
+        case 'n':
+            findNext();
+            break;
+        case PK_ESCAPE:
+            m_cancel = true;
+            break;
+        case ':':
+            if (prompt(out, input))
+            {
+                char*          end;
+                const SKuint64 address = strtoull(input.c_str(), &end, 16);
+                if (*end != 0 || address < m_base || address >= m_base + m_size)
+                    m_status = "address is out of range";
+                else
+                    moveTo((SKsize)(address - m_base));
+            }
+            break;
+        default:
+            redraw = key != PK_NONE;
+            break;
+        }
+    }
+
+    m_cancel = true;
+    if (m_worker.joinable())
+        m_worker.join();
+    return 0;
+}
+
+#endif
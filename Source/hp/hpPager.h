@@ -0,0 +1,87 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _hpPager_h_
+#define _hpPager_h_
+
+#include <atomic>
+#include <thread>
+#include "Utils/skString.h"
+#include "hpFormatter.h"
+
+class OutputBuffer;
+class PatternSearch;
+
+// Interactive view of a mapped range. Only the rows on screen are
+// formatted, so the cost of a key press does not depend on the size of
+// the range. Searches for the next --mark sequence run on a worker thread
+// while the view stays responsive.
+class Pager
+{
+private:
+    const SKuint8*       m_data;
+    SKsize               m_size;
+    SKuint64             m_base;
+    HexFormatter         m_fmt;
+    const PatternSearch* m_search;
+    SKsize               m_top;
+    SKsize               m_match;
+    SKint32              m_rows;
+    SKint32              m_columns;
+    skString             m_status;
+    SKuint8*             m_marks;
+
+    std::thread          m_worker;
+    std::atomic<SKsize>  m_result;
+    std::atomic<bool>    m_searching;
+    std::atomic<bool>    m_cancel;
+
+    bool resize();
+
+    void draw(OutputBuffer& out);
+
+    void drawStatus(OutputBuffer& out);
+
+    void scroll(SKint64 rows);
+
+    void moveTo(SKsize offset);
+
+    void findNext();
+
+    void finishSearch();
+
+    bool prompt(OutputBuffer& out, skString& dest);
+
+    void search(SKsize from);
+
+public:
+    Pager(const SKuint8*       data,
+          SKsize               size,
+          SKuint64             base,
+          SKuint32             flags,
+          SKuint32             width,
+          const PatternSearch* search);
+    ~Pager();
+
+    // Runs until q or ^C is pressed or a quit signal arrives, returns
+    // non zero if the terminal could not be used.
+    int run();
+};
+
+#endif  //_hpPager_h_
@@ -0,0 +1,338 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "hpReverse.h"
+#include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
+#include "baseCodec.h"
+
+const SKsize BlockSize = 1 << 20;
+const SKsize MaxLine   = 4096;
+
+namespace
+{
+    SK_INLINE bool isHexDigit(char ch)
+    {
+        return (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f');
+    }
+
+    // Returns the number of address digits when line starts with an
+    // 8 or 16 digit address followed by two spaces, otherwise zero.
+    SKsize addressDigits(const char* line, SKsize len)
+    {
+        SKsize n = 0;
+        while (n < len && n < 17 && isHexDigit(line[n]))
+            ++n;
+
+        if ((n == 8 || n == 16) && n + 2 <= len && line[n] == ' ' && line[n + 1] == ' ')
+            return n;
+        if ((n == 8 || n == 16) && (n == len || line[n] == '\n' || line[n] == '\r'))
+            return n;
+        return 0;
+    }
+
+    int seek(FILE* fp, SKuint64 address)
+    {
+#ifdef _WIN32
+        return _fseeki64(fp, (__int64)address, SEEK_SET);
+#else
+        return fseeko(fp, (off_t)address, SEEK_SET);
+#endif
+    }
+
+    SKuint64 parseAddress(const char* line, SKsize n)
+    {
+        SKuint64 v = 0;
+        for (SKsize i = 0; i < n; ++i)
+        {
+            const char ch = line[i];
+            v = v << 4 | (SKuint64)(ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10);
+        }
+        return v;
+    }
+
+    // Removes the color escapes of a marked line.
+    SKsize stripEscapes(const char* src, SKsize len, char* dest)
+    {
+        SKsize o = 0;
+        for (SKsize i = 0; i < len; ++i)
+        {
+            if (src[i] == '\x1b')
+            {
+                while (i < len && src[i] != 'm')
+                    ++i;
+            }
+            else
+                dest[o++] = src[i];
+        }
+        return o;
+    }
+}  // namespace
+
+HexReader::HexReader(FILE* fp) :
+    m_fp(fp),
+    m_digits(new char[BlockSize + 16]),
+    m_bytes(new SKuint8[BlockSize / 2 + 16]),
+    m_lastSize(0),
+    m_lastDigits(0),
+    m_position(0),
+    m_runAddress(0),
+    m_runDigits(0),
+    m_repeat(false)
+{
+}
+
+HexReader::~HexReader()
+{
+    delete[] m_bytes;
+    delete[] m_digits;
+}
+
+bool HexReader::isDump(const char* text, SKsize len)
+{
+    const SKsize n = addressDigits(text, len);
+    return n > 0 && n + 2 < len && isHexDigit(text[n + 2]);
+}
+
+bool HexReader::isColumnDump(const char* text, SKsize len)
+{
+    char line[MaxLine];
+
+    const char* nl = (const char*)memchr(text, '\n', skMin(len, MaxLine));
+    SKsize      n  = stripEscapes(text, nl ? (SKsize)(nl - text) : skMin(len, MaxLine), line);
+    if (n > 0 && line[n - 1] == '\r')
+        --n;
+
+    // hex bytes, then the ASCII column between bars at the end of the line
+    const char* bar = (const char*)memchr(line, '|', n);
+    if (!bar || n < 2 || line[n - 1] != '|' || bar == line + n - 1)
+        return false;
+
+    SKsize digits = 0;
+    for (const char* cp = line; cp < bar; ++cp)
+    {
+        if (isHexDigit(*cp))
+            ++digits;
+        else if (*cp != ' ')
+            return false;
+    }
+    return digits > 0 && digits % 2 == 0;
+}
+
+bool HexReader::writeAt(SKuint64 address, const SKuint8* data, SKsize len)
+{
+    if (address != m_position)
+    {
+        // Gaps are left to the file system when the output can seek,
+        // otherwise they are filled with zeros.
+        if (seek(m_fp, address) != 0)
+        {
+            if (address < m_position)
+                return false;
+
+            const SKuint8 zeros[256] = {};
+            while (m_position < address)
+            {
+                const SKsize n = (SKsize)skMin<SKuint64>(sizeof zeros, address - m_position);
+                fwrite(zeros, 1, n, m_fp);
+                m_position += n;
+            }
+        }
+        m_position = address;
+    }
+
+    if (len > 0 && fwrite(data, 1, len, m_fp) != len)
+        return false;
+    m_position += len;
+    return true;
+}
+
+bool HexReader::writeRun()
+{
+    const SKsize size = BaseCodec::decodeHex(m_digits, m_runDigits, m_bytes);
+
+    // keep the last line for a squeezed run that may follow
+    m_lastSize = m_lastDigits / 2;
+    memcpy(m_last, m_bytes + size - m_lastSize, m_lastSize);
+
+    m_runDigits = 0;
+    return writeAt(m_runAddress, m_bytes, size);
+}
+
+bool HexReader::writeRepeat(SKuint64 address)
+{
+    if (m_lastSize == 0 || m_position + m_lastSize > address)
+        return true;
+
+    // a block of whole copies of the last line is written at a time
+    const SKsize copies = (BlockSize / 2) / m_lastSize;
+    for (SKsize i = 0; i < copies; ++i)
+        memcpy(m_bytes + i * m_lastSize, m_last, m_lastSize);
+
+    while (m_position + m_lastSize <= address)
+    {
+        const SKuint64 count = skMin<SKuint64>(copies, (address - m_position) / m_lastSize);
+        if (!writeAt(m_position, m_bytes, (SKsize)count * m_lastSize))
+            return false;
+    }
+    return true;
+}
+
+bool HexReader::readDump(const char* text, SKsize len, bool addresses)
+{
+    char   stripped[MaxLine];
+    SKsize line = 0;
+
+    // Lines that continue at the address where the previous one ended are
+    // compacted into one run, which is decoded and written in one go when
+    // the address jumps, a squeezed run starts or the buffer fills.
+    m_runAddress = m_position;
+    m_runDigits  = 0;
+
+    for (SKsize i = 0; i < len;)
+    {
+        const char* cp = text + i;
+        const char* nl = (const char*)memchr(cp, '\n', len - i);
+        SKsize      n  = nl ? (SKsize)(nl - cp) : len - i;
+        i += n + 1;
+        ++line;
+
+        if (n > 0 && cp[n - 1] == '\r')
+            --n;
+        if (n == 0 || (n == 2 && cp[0] == '-' && cp[1] == '-'))
+            continue;
+
+        if (n == 1 && cp[0] == '*')
+        {
+            if (!addresses)
+            {
+                skLogf(LD_ERROR, "line %llu: squeezed lines need addresses\n", (unsigned long long)line);
+                return false;
+            }
+            m_repeat = true;
+            continue;
+        }
+
+        if (memchr(cp, '\x1b', n))
+        {
+            n  = stripEscapes(cp, skMin(n, MaxLine), stripped);
+            cp = stripped;
+        }
+
+        // without addresses each line follows the one before it
+        const SKsize ad = addresses ? addressDigits(cp, n) : 0;
+        if (addresses && ad == 0)
+        {
+            skLogf(LD_ERROR, "line %llu: expected an address\n", (unsigned long long)line);
+            return false;
+        }
+
+        const SKuint64 address = addresses ? parseAddress(cp, ad) : m_runAddress + m_runDigits / 2;
+
+        // the hex columns end at the ASCII column
+        const char*  hex = cp + ad;
+        const char*  bar = (const char*)memchr(hex, '|', n - ad);
+        const SKsize hn  = bar ? (SKsize)(bar - hex) : n - ad;
+        if (hn > MaxLine)
+        {
+            skLogf(LD_ERROR, "line %llu: invalid hex columns\n", (unsigned long long)line);
+            return false;
+        }
+
+        if (m_repeat || address != m_runAddress + m_runDigits / 2 || m_runDigits + hn > BlockSize)
+        {
+            if (!writeRun() || (m_repeat && !writeRepeat(address)))
+            {
+                skLogf(LD_ERROR, "line %llu: failed to write the output\n", (unsigned long long)line);
+                return false;
+            }
+            m_repeat     = false;
+            m_runAddress = address;
+        }
+
+        const SKsize digits = BaseCodec::compactHex(hex, hn, m_digits + m_runDigits);
+        if (digits == SK_NPOS || digits % 2 != 0 || digits / 2 > sizeof m_last)
+        {
+            skLogf(LD_ERROR, "line %llu: invalid hex columns\n", (unsigned long long)line);
+            return false;
+        }
+
+        m_lastDigits = digits;
+        m_runDigits += digits;
+    }
+
+    if (!writeRun())
+    {
+        skLogf(LD_ERROR, "failed to write the output\n");
+        return false;
+    }
+    return true;
+}
+
+bool HexReader::readStream(const char* text, SKsize len)
+{
+    char   pending = 0;
+    SKsize i       = 0;
+
+    while (i < len)
+    {
+        SKsize n = skMin(BlockSize - 1, len - i);
+
+        // keep a 0x prefix in one block, split digits carry over as pending
+        if (i + n < len && text[i + n - 1] == '0' && (text[i + n] | 0x20) == 'x')
+            --n;
+
+        char* dest = m_digits;
+        if (pending)
+            *dest++ = pending;
+
+        const SKsize digits = BaseCodec::compactHex(text + i, n, dest);
+        if (digits == SK_NPOS)
+        {
+            skLogf(LD_ERROR, "invalid character in the block at %llu\n", (unsigned long long)i);
+            return false;
+        }
+
+        SKsize total = digits + (pending ? 1 : 0);
+        pending      = 0;
+        if (total % 2 != 0)
+            pending = m_digits[--total];
+
+        const SKsize size = BaseCodec::decodeHex(m_digits, total, m_bytes);
+        if (size == SK_NPOS || fwrite(m_bytes, 1, size, m_fp) != size)
+            return false;
+        i += n;
+    }
+
+    if (pending)
+    {
+        skLogf(LD_ERROR, "odd number of hex digits\n");
+        return false;
+    }
+    return true;
+}
+
+bool HexReader::read(const char* text, SKsize len)
+{
+    if (isDump(text, len))
+        return readDump(text, len, true);
+    if (isColumnDump(text, len))
+        return readDump(text, len, false);
+    return readStream(text, len);
+}
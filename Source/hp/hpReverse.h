@@ -0,0 +1,68 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _hpReverse_h_
+#define _hpReverse_h_
+
+#include <cstdio>
+#include "Utils/skString.h"
+
+// Converts hex text back into bytes. Accepts the dumps that hp writes,
+// with or without addresses and including squeezed lines, as well as
+// streams of hex digits separated by white space, commas or 0x prefixes
+// such as the --csv output.
+class HexReader
+{
+private:
+    FILE*    m_fp;
+    char*    m_digits;
+    SKuint8* m_bytes;
+    SKuint8  m_last[256];
+    SKsize   m_lastSize;
+    SKsize   m_lastDigits;
+    SKuint64 m_position;
+    SKuint64 m_runAddress;
+    SKsize   m_runDigits;
+    bool     m_repeat;
+
+    bool writeAt(SKuint64 address, const SKuint8* data, SKsize len);
+
+    bool writeRun();
+
+    bool writeRepeat(SKuint64 address);
+
+    bool readDump(const char* text, SKsize len, bool addresses);
+
+    bool readStream(const char* text, SKsize len);
+
+public:
+    explicit HexReader(FILE* fp);
+    ~HexReader();
+
+    // Returns true if the text starts with a line in hp's dump format.
+    static bool isDump(const char* text, SKsize len);
+
+    // Returns true if the text starts with a dump line printed without
+    // an address, hex bytes followed by the ASCII column.
+    static bool isColumnDump(const char* text, SKsize len);
+
+    bool read(const char* text, SKsize len);
+};
+
+#endif  //_hpReverse_h_
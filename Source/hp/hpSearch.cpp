@@ -0,0 +1,205 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "hpSearch.h"
+#include "Utils/skMemoryUtils.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define HP_SEARCH_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace
+{
+    int hexValue(char ch)
+    {
+        if (ch >= '0' && ch <= '9')
+            return ch - '0';
+        if (ch >= 'a' && ch <= 'f')
+            return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F')
+            return ch - 'A' + 10;
+        return -1;
+    }
+
+#ifdef HP_SEARCH_SSE2
+    SK_INLINE SKuint32 lowestBit(SKuint32 v)
+    {
+#ifdef _MSC_VER
+        unsigned long r;
+        _BitScanForward(&r, v);
+        return (SKuint32)r;
+#else
+        return (SKuint32)__builtin_ctz(v);
+#endif
+    }
+#endif
+}  // namespace
+
+PatternSearch::PatternSearch() :
+    m_maxLength(0)
+{
+}
+
+bool PatternSearch::add(const char* text)
+{
+    if (!text)
+        return false;
+
+    if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+        text += 2;
+
+    SKsize digits = strlen(text);
+    if (digits == 0)
+        return false;
+
+    // An odd number of digits reads as a number, so the
+    // leading nibble is zero rather than a wildcard.
+    Pattern pat;
+    pat.offset = m_values.size();
+    pat.length = (SKuint32)((digits + 1) / 2);
+
+    SKuint8 value = 0, mask = 0;
+    SKsize  nibble = digits % 2;
+    if (nibble)
+        mask = 0x0F;
+
+    for (const char* cp = text; *cp; ++cp, ++nibble)
+    {
+        int v = 0, m = 0xF;
+        if (*cp == '?')
+            m = 0;
+        else if ((v = hexValue(*cp)) < 0)
+            return false;
+
+        value = (SKuint8)(value << 4 | v);
+        mask  = (SKuint8)(mask << 4 | m);
+
+        if (nibble & 1)
+        {
+            m_values.push_back(value);
+            m_masks.push_back(mask);
+            value = mask = 0;
+        }
+    }
+
+    m_patterns.push_back(pat);
+    m_maxLength = skMax(m_maxLength, pat.length);
+    return true;
+}
+
+bool PatternSearch::matches(const Pattern& pat, const SKuint8* data) const
+{
+    const SKuint8* value = &m_values[pat.offset];
+    const SKuint8* mask  = &m_masks[pat.offset];
+
+    for (SKuint32 i = 0; i < pat.length; ++i)
+    {
+        if ((data[i] & mask[i]) != value[i])
+            return false;
+    }
+    return true;
+}
+
+SKsize PatternSearch::scanPattern(const Pattern& pat,
+                                  SKuint8*       marks,
+                                  const SKuint8* data,
+                                  SKsize         len,
+                                  SKsize         from) const
+{
+    const SKuint32 n = pat.length;
+    if (len < n)
+        return marks ? 0 : SK_NPOS;
+
+    const SKsize end = len - n + 1;
+
+    SKsize i     = from + 1 > n ? from + 1 - n : 0;
+    SKsize found = 0;
+
+#ifdef HP_SEARCH_SSE2
+    const SKuint32 l = n - 1;
+
+    const __m128i fv = _mm_set1_epi8((char)m_values[pat.offset]);
+    const __m128i fm = _mm_set1_epi8((char)m_masks[pat.offset]);
+    const __m128i lv = _mm_set1_epi8((char)m_values[pat.offset + l]);
+    const __m128i lm = _mm_set1_epi8((char)m_masks[pat.offset + l]);
+
+    for (; i + 16 <= end; i += 16)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*)(data + i + l));
+
+        const __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(a, fm), fv),
+                                         _mm_cmpeq_epi8(_mm_and_si128(b, lm), lv));
+
+        SKuint32 bits = (SKuint32)_mm_movemask_epi8(eq);
+        while (bits)
+        {
+            const SKsize j = i + lowestBit(bits);
+            bits &= bits - 1;
+
+            if (matches(pat, data + j))
+            {
+                if (!marks)
+                    return j;
+                skMemset(marks + j, 1, n);
+                ++found;
+            }
+        }
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        if (matches(pat, data + i))
+        {
+            if (!marks)
+                return i;
+            skMemset(marks + i, 1, n);
+            ++found;
+        }
+    }
+    return marks ? found : SK_NPOS;
+}
+
+SKsize PatternSearch::mark(SKuint8* marks, const SKuint8* data, SKsize len, SKsize from) const
+{
+    SKsize found = 0;
+    for (SKsize i = 0; i < m_patterns.size(); ++i)
+        found += scanPattern(m_patterns[i], marks, data, len, from);
+    return found;
+}
+
+SKsize PatternSearch::find(const SKuint8* data, SKsize len) const
+{
+    SKsize first = SK_NPOS;
+    for (SKsize i = 0; i < m_patterns.size(); ++i)
+    {
+        // later patterns only need to be searched up to the first match
+        const SKsize limit = first == SK_NPOS ? len : skMin<SKsize>(len, first + m_patterns[i].length);
+
+        const SKsize pos = scanPattern(m_patterns[i], nullptr, data, limit, 0);
+        if (pos < first)
+            first = pos;
+    }
+    return first;
+}
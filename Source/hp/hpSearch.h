@@ -0,0 +1,78 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _hpSearch_h_
+#define _hpSearch_h_
+
+#include "Utils/skArray.h"
+#include "Utils/skString.h"
+
+// Finds a set of byte sequences in a buffer. Each byte of a sequence has
+// a mask so that either nibble may be a wildcard. Candidates are found by
+// comparing the first and last byte of a sequence 16 positions at a time,
+// then verified in full.
+class PatternSearch
+{
+private:
+    struct Pattern
+    {
+        SKsize   offset;
+        SKuint32 length;
+    };
+
+    skArray<Pattern> m_patterns;
+    skArray<SKuint8> m_values;
+    skArray<SKuint8> m_masks;
+    SKuint32         m_maxLength;
+
+    bool matches(const Pattern& pat, const SKuint8* data) const;
+
+    // Marks every match and returns the number found, or when
+    // marks is null returns the start of the first match or SK_NPOS.
+    SKsize scanPattern(const Pattern& pat, SKuint8* marks, const SKuint8* data, SKsize len, SKsize from) const;
+
+public:
+    PatternSearch();
+
+    // Adds a sequence of hex digits where ? matches any nibble,
+    // for example 7F454C46 or 4D5A??00. Returns false if the text is
+    // not a valid sequence.
+    bool add(const char* text);
+
+    SK_INLINE bool empty() const
+    {
+        return m_patterns.empty();
+    }
+
+    SK_INLINE SKuint32 getMaxLength() const
+    {
+        return m_maxLength;
+    }
+
+    // Flags every byte that is covered by a sequence that ends past from,
+    // and returns the number of sequences found. Matches that end at or
+    // before from are skipped so that overlapping windows report each
+    // match once.
+    SKsize mark(SKuint8* marks, const SKuint8* data, SKsize len, SKsize from) const;
+
+    // Returns the start of the first match in data, or SK_NPOS.
+    SKsize find(const SKuint8* data, SKsize len) const;
+};
+
+#endif  //_hpSearch_h_
@@ -0,0 +1,439 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "hpTemplate.h"
+#include <cstdlib>
+#include "Utils/skFileStream.h"
+#include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
+#include "hpWordFormatter.h"
+#include "outputBuffer.h"
+
+namespace
+{
+    struct FieldType
+    {
+        const char* name;
+        SKuint32    size;
+        SKuint32    field;
+    };
+
+    // The field is wide enough for the longest value of each type.
+    const FieldType FieldTypeTable[FT_MAX] = {
+        {"u8", 1, 3},
+        {"u16", 2, 5},
+        {"u32", 4, 10},
+        {"u64", 8, 20},
+        {"i8", 1, 4},
+        {"i16", 2, 6},
+        {"i32", 4, 11},
+        {"i64", 8, 20},
+        {"f32", 4, 32},
+        {"f64", 8, 32},
+        {"char", 1, 0},
+    };
+
+    const SKuint32 MaxCount = 1 << 16;
+
+    // Records are read a chunk at a time, so their size is kept well below
+    // what a column offset can hold.
+    const SKuint64 MaxRecordSize = 1 << 24;
+
+    SKuint32 findFieldType(const char* name, SKsize len)
+    {
+        for (SKuint32 i = 0; i < FT_MAX; ++i)
+        {
+            if (strlen(FieldTypeTable[i].name) == len &&
+                strncmp(FieldTypeTable[i].name, name, len) == 0)
+                return i;
+        }
+        return FT_MAX;
+    }
+
+    bool isName(const char* str)
+    {
+        for (; *str; ++str)
+        {
+            if (!(isalnum((unsigned char)*str) || *str == '_'))
+                return false;
+        }
+        return true;
+    }
+
+    char* nextToken(char*& str)
+    {
+        while (*str == ' ' || *str == '\t')
+            ++str;
+        if (!*str)
+            return nullptr;
+
+        char* token = str;
+        while (*str && *str != ' ' && *str != '\t')
+            ++str;
+        if (*str)
+            *str++ = 0;
+        return token;
+    }
+
+    // Reads size bytes in the given order into the low bytes of the result.
+    SK_INLINE SKuint64 loadValue(const SKuint8* src, SKuint32 size, bool bigEndian)
+    {
+        SKuint64 v = 0;
+        if (bigEndian)
+        {
+            for (SKuint32 k = 0; k < size; ++k)
+                v = v << 8 | src[k];
+        }
+        else
+        {
+            for (SKuint32 k = size; k > 0; --k)
+                v = v << 8 | src[k - 1];
+        }
+        return v;
+    }
+}  // namespace
+
+RecordTemplate::RecordTemplate() :
+    m_recordSize(0),
+    m_lineSize(1)
+{
+}
+
+bool RecordTemplate::addField(const char* path, const char* name, char* line, bool bigEndian, SKuint64& offset)
+{
+    char* spec = nextToken(line);
+    char* at   = nextToken(line);
+
+    if (!spec || !isName(name))
+    {
+        skLogf(LD_ERROR, "%s: invalid field '%s'\n", path, name);
+        return false;
+    }
+
+    SKuint32 count = 0;
+    char*    open  = strchr(spec, '[');
+    if (open)
+    {
+        char* end = nullptr;
+        count     = (SKuint32)strtoul(open + 1, &end, 0);
+        if (count < 1 || count > MaxCount || *end != ']' || end[1])
+        {
+            skLogf(LD_ERROR, "%s: invalid array size for field %s\n", path, name);
+            return false;
+        }
+        *open = 0;
+    }
+
+    // a le or be suffix overrides the byte order for this field
+    SKsize   len  = strlen(spec);
+    SKuint32 type = findFieldType(spec, len);
+    if (type == FT_MAX && len > 2)
+    {
+        type = findFieldType(spec, len - 2);
+        if (strcmp(spec + len - 2, "be") == 0)
+            bigEndian = true;
+        else if (strcmp(spec + len - 2, "le") == 0)
+            bigEndian = false;
+        else
+            type = FT_MAX;
+    }
+
+    if (type == FT_MAX)
+    {
+        skLogf(LD_ERROR, "%s: unknown type '%s' for field %s\n", path, spec, name);
+        return false;
+    }
+
+    if (at)
+    {
+        char* end = nullptr;
+        if (*at != '@' || (offset = strtoull(at + 1, &end, 0), *end))
+        {
+            skLogf(LD_ERROR, "%s: invalid offset '%s' for field %s\n", path, at, name);
+            return false;
+        }
+    }
+
+    const SKuint32 size  = FieldTypeTable[type].size;
+    const SKuint32 items = type == FT_CHAR ? 1 : skMax<SKuint32>(count, 1);
+    const SKuint32 width = type == FT_CHAR ? skMax<SKuint32>(count, 1) : size;
+
+    if (offset > MaxRecordSize || (SKuint64)items * width > MaxRecordSize - offset)
+    {
+        skLogf(LD_ERROR, "%s: field %s ends past the largest record size\n", path, name);
+        return false;
+    }
+
+    for (SKuint32 i = 0; i < items; ++i)
+    {
+        if (!m_columns.empty())
+            m_names.append(',');
+
+        Column col;
+        col.offset    = (SKuint32)offset;
+        col.size      = width;
+        col.type      = type;
+        col.bigEndian = bigEndian && size > 1;
+        col.name      = (SKuint32)m_names.size();
+
+        m_names.append(name);
+        if (count > 0 && type != FT_CHAR)
+        {
+            char index[16];
+            skSprintf(index, sizeof index, ".%u", i);
+            m_names.append(index);
+        }
+        col.nameLength = (SKuint32)m_names.size() - col.name;
+        m_columns.push_back(col);
+
+        // a quote may be doubled for each character
+        m_lineSize += 1 + (type == FT_CHAR ? 2 + 2 * width : FieldTypeTable[type].field);
+        offset += width;
+    }
+    return true;
+}
+
+bool RecordTemplate::load(const char* path)
+{
+    skFileStream fp;
+    fp.open(path, skStream::READ);
+    if (!fp.isOpen())
+    {
+        skLogf(LD_ERROR, "Failed to open file %s\n", path);
+        return false;
+    }
+
+    const SKsize size = fp.size();
+
+    char* text = new char[size + 1];
+    text[fp.read(text, size)] = 0;
+
+    SKuint64 offset = 0, extent = 0;
+    SKuint32 recordSize = 0;
+    bool     bigEndian = false, result = true;
+
+    char* line = text;
+    while (result && line && *line)
+    {
+        char* next = strchr(line, '\n');
+        if (next)
+            *next++ = 0;
+
+        char* comment = strchr(line, '#');
+        if (comment)
+            *comment = 0;
+
+        SKsize len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t'))
+            line[--len] = 0;
+
+        char* rest = line;
+        char* word = nextToken(rest);
+        if (!word)
+        {
+            line = next;
+            continue;
+        }
+
+        if (strcmp(word, "size") == 0)
+        {
+            char* value = nextToken(rest);
+            const SKuint64 v = value ? strtoull(value, nullptr, 0) : 0;
+            recordSize       = (SKuint32)v;
+            if (v == 0 || v > MaxRecordSize)
+            {
+                skLogf(LD_ERROR, "%s: invalid record size\n", path);
+                result = false;
+            }
+        }
+        else if (strcmp(word, "endian") == 0)
+        {
+            char* value = nextToken(rest);
+            if (value && strcmp(value, "big") == 0)
+                bigEndian = true;
+            else if (value && strcmp(value, "little") == 0)
+                bigEndian = false;
+            else
+            {
+                skLogf(LD_ERROR, "%s: endian must be little or big\n", path);
+                result = false;
+            }
+        }
+        else
+        {
+            result = addField(path, word, rest, bigEndian, offset);
+            extent = skMax(extent, offset);
+        }
+        line = next;
+    }
+    delete[] text;
+
+    if (!result)
+        return false;
+
+    if (m_columns.empty())
+    {
+        skLogf(LD_ERROR, "%s: the template has no fields\n", path);
+        return false;
+    }
+
+    if (recordSize != 0 && recordSize < extent)
+    {
+        skLogf(LD_ERROR, "%s: the fields end past the record size of %u\n", path, recordSize);
+        return false;
+    }
+
+    m_recordSize = recordSize != 0 ? recordSize : (SKuint32)extent;
+    return true;
+}
+
+void RecordTemplate::writeHeader(OutputBuffer& out) const
+{
+    out.write(m_names.c_str(), m_names.size());
+    out.write("\n", 1);
+}
+
+char* RecordTemplate::formatValue(char* dest, const Column& col, const SKuint8* record) const
+{
+    const SKuint8* src = record + col.offset;
+
+    if (col.type == FT_CHAR)
+    {
+        // text ends at the first zero, other unprintable bytes are written as dots
+        *dest++ = '"';
+        for (SKuint32 i = 0; i < col.size && src[i]; ++i)
+        {
+            if (src[i] == '"')
+                *dest++ = '"';
+            *dest++ = src[i] >= 32 && src[i] < 127 ? (char)src[i] : '.';
+        }
+        *dest++ = '"';
+        return dest;
+    }
+
+    const SKuint64 v = loadValue(src, col.size, col.bigEndian);
+
+    char  digits[24];
+    char* const end = digits + sizeof digits;
+    char*       start;
+
+    switch (col.type)
+    {
+    case FT_U8:
+    case FT_U16:
+    case FT_U32:
+    case FT_U64:
+        start = WordFormatter::formatUnsigned(end, v);
+        break;
+    case FT_I8:
+    case FT_I16:
+    case FT_I32:
+    case FT_I64:
+    {
+        // sign extend from the field size
+        const SKuint32 shift = 64 - 8 * col.size;
+        start                = WordFormatter::formatSigned(end, (SKint64)(v << shift) >> shift);
+        break;
+    }
+    default:
+    {
+        double d;
+        if (col.type == FT_F32)
+        {
+            float    f;
+            SKuint32 bits = (SKuint32)v;
+            memcpy(&f, &bits, 4);
+            d = f;
+        }
+        else
+            memcpy(&d, &v, 8);
+
+        const int n = skSprintf(dest, FieldTypeTable[col.type].field, "%.*g", col.type == FT_F32 ? 9 : 17, d);
+        return n > 0 ? dest + skMin<int>(n, FieldTypeTable[col.type].field - 1) : dest;
+    }
+    }
+
+    memcpy(dest, start, (SKsize)(end - start));
+    return dest + (end - start);
+}
+
+void RecordTemplate::formatRecords(OutputBuffer& out, const SKuint8* data, SKsize count) const
+{
+    const SKuint32 columns = (SKuint32)m_columns.size();
+
+    for (SKsize r = 0; r < count; ++r)
+    {
+        const SKuint8* record = data + r * m_recordSize;
+
+        char* const start = out.reserve(m_lineSize);
+        char*       dest  = formatValue(start, m_columns[0], record);
+
+        for (SKuint32 i = 1; i < columns; ++i)
+        {
+            *dest++ = ',';
+            dest    = formatValue(dest, m_columns[i], record);
+        }
+        *dest++ = '\n';
+        out.commit((SKsize)(dest - start));
+    }
+}
+
+void RecordTemplate::formatColumns(OutputBuffer** columns, const SKuint8* data, SKsize count) const
+{
+    for (SKuint32 i = 0; i < m_columns.size(); ++i)
+    {
+        const Column&  col = m_columns[i];
+        OutputBuffer&  out = *columns[i];
+        const SKuint8* src = data + col.offset;
+
+        for (SKsize r = 0; r < count; ++r, src += m_recordSize)
+        {
+            char* dest = out.reserve(col.size);
+
+            // values are stored through the matching integer type so
+            // that they are written in the byte order of the host
+            const SKuint64 v = col.type == FT_CHAR ? 0 : loadValue(src, col.size, col.bigEndian);
+            switch (col.type == FT_CHAR ? 0 : col.size)
+            {
+            case 1:
+                *dest = (char)v;
+                break;
+            case 2:
+            {
+                const SKuint16 w = (SKuint16)v;
+                memcpy(dest, &w, 2);
+                break;
+            }
+            case 4:
+            {
+                const SKuint32 w = (SKuint32)v;
+                memcpy(dest, &w, 4);
+                break;
+            }
+            case 8:
+                memcpy(dest, &v, 8);
+                break;
+            default:
+                memcpy(dest, src, col.size);
+                break;
+            }
+            out.commit(col.size);
+        }
+    }
+}
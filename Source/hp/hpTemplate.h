@@ -0,0 +1,114 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _hpTemplate_h_
+#define _hpTemplate_h_
+
+#include "Utils/skArray.h"
+#include "Utils/skString.h"
+
+class OutputBuffer;
+
+enum FieldTypes
+{
+    FT_U8 = 0,
+    FT_U16,
+    FT_U32,
+    FT_U64,
+    FT_I8,
+    FT_I16,
+    FT_I32,
+    FT_I64,
+    FT_F32,
+    FT_F64,
+    FT_CHAR,
+    FT_MAX
+};
+
+// Fixed size record layout read from a template file. Each line of the
+// file declares a field or sets an option for the fields that follow.
+//
+//   size 32            bytes per record, defaults to the end of the last field
+//   endian big         byte order of the fields that follow, little or big
+//   name type[count]   a field, optionally an array, at the next offset
+//   name type @offset  a field at a byte offset from the start of the record
+//
+// The layout is compiled into a flat list of columns, one per array
+// element, so decoding a record is a single pass over the list.
+class RecordTemplate
+{
+public:
+    struct Column
+    {
+        SKuint32 offset;
+        SKuint32 size;
+        SKuint32 type;
+        bool     bigEndian;
+        SKuint32 name;
+        SKuint32 nameLength;
+    };
+
+private:
+    skArray<Column> m_columns;
+    skString        m_names;
+    SKuint32        m_recordSize;
+    SKsize          m_lineSize;
+
+    bool addField(const char* path, const char* name, char* line, bool bigEndian, SKuint64& offset);
+
+    char* formatValue(char* dest, const Column& col, const SKuint8* record) const;
+
+public:
+    RecordTemplate();
+
+    bool load(const char* path);
+
+    SK_INLINE SKuint32 getRecordSize() const
+    {
+        return m_recordSize;
+    }
+
+    SK_INLINE SKuint32 getColumnCount() const
+    {
+        return (SKuint32)m_columns.size();
+    }
+
+    SK_INLINE const Column& getColumn(SKuint32 i) const
+    {
+        return m_columns[i];
+    }
+
+    // Returns the column names separated by commas. Each column refers to
+    // its name with an offset and length, array elements are named name.index.
+    SK_INLINE const skString& getNames() const
+    {
+        return m_names;
+    }
+
+    void writeHeader(OutputBuffer& out) const;
+
+    // Writes one comma separated line for each of the count records.
+    void formatRecords(OutputBuffer& out, const SKuint8* data, SKsize count) const;
+
+    // Appends the value of column i from each of the count records to
+    // columns[i], in the byte order of the host.
+    void formatColumns(OutputBuffer** columns, const SKuint8* data, SKsize count) const;
+};
+
+#endif  //_hpTemplate_h_
@@ -0,0 +1,271 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "hpWordFormatter.h"
+#include "Utils/skHexPrint.h"
+#include "Utils/skMemoryUtils.h"
+#include "hpFormatter.h"
+#include "outputBuffer.h"
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define HP_WORD_SSSE3
+#include <tmmintrin.h>
+#endif
+
+using namespace skHexPrint;
+
+namespace
+{
+    struct WordType
+    {
+        const char* name;
+        SKuint32    size;
+        SKuint32    field;
+    };
+
+    // The field is wide enough for the longest value of each type.
+    const WordType WordTypeTable[WT_MAX] = {
+        {"u16", 2, 5},
+        {"u32", 4, 10},
+        {"u64", 8, 20},
+        {"i16", 2, 6},
+        {"i32", 4, 11},
+        {"i64", 8, 20},
+        {"f32", 4, 15},
+        {"f64", 8, 24},
+    };
+
+    const char HexDigits[] = "0123456789ABCDEF";
+
+    class DigitTable
+    {
+    public:
+        char pairs[200];
+
+        DigitTable()
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                pairs[i * 2]     = (char)('0' + i / 10);
+                pairs[i * 2 + 1] = (char)('0' + i % 10);
+            }
+        }
+    };
+
+    const DigitTable Digits;
+
+    SK_INLINE char* writeDigits(char* end, SKuint64 v)
+    {
+        while (v >= 100)
+        {
+            const SKuint64 i = (v % 100) * 2;
+            v /= 100;
+            end -= 2;
+            memcpy(end, Digits.pairs + i, 2);
+        }
+
+        if (v >= 10)
+        {
+            end -= 2;
+            memcpy(end, Digits.pairs + v * 2, 2);
+        }
+        else
+            *--end = (char)('0' + v);
+        return end;
+    }
+}  // namespace
+
+WordFormatter::WordFormatter(SKuint32 flags, SKuint32 width, SKuint32 type, bool bigEndian) :
+    m_flags(flags),
+    m_width(skClamp<SKuint32>(width, HexFormatter::MinWidth, HexFormatter::MaxWidth) & ~(SKuint32)15),
+    m_type(skMin<SKuint32>(type, WT_MAX - 1)),
+    m_size(WordTypeTable[m_type].size),
+    m_field(WordTypeTable[m_type].field),
+    m_bigEndian(bigEndian)
+{
+    // address, one field and separator per word, the ASCII column, and
+    // room for the trailing bytes written as hex
+    m_lineSize = 18 + (m_width / m_size) * (m_field + 1) + m_width + 3 + 3 * m_size + 16;
+}
+
+char* WordFormatter::formatUnsigned(char* end, SKuint64 v)
+{
+    return writeDigits(end, v);
+}
+
+char* WordFormatter::formatSigned(char* end, SKint64 v)
+{
+    if (v >= 0)
+        return writeDigits(end, (SKuint64)v);
+
+    char* start = writeDigits(end, 0 - (SKuint64)v);
+    *--start    = '-';
+    return start;
+}
+
+SKuint32 WordFormatter::findType(const char* name)
+{
+    for (SKuint32 i = 0; i < WT_MAX; ++i)
+    {
+        if (name && strcmp(name, WordTypeTable[i].name) == 0)
+            return i;
+    }
+    return WT_MAX;
+}
+
+void WordFormatter::swap(SKuint8* dest, const SKuint8* src, SKuint32 len) const
+{
+    SKuint32 i = 0;
+
+#ifdef HP_WORD_SSSE3
+    const __m128i order = m_size == 2   ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+                          : m_size == 4 ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                                        : _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_shuffle_epi8(v, order));
+    }
+#endif
+
+    for (; i + m_size <= len; i += m_size)
+    {
+        for (SKuint32 k = 0; k < m_size; ++k)
+            dest[i + k] = src[i + m_size - 1 - k];
+    }
+}
+
+char* WordFormatter::formatWord(char* dest, const SKuint8* src) const
+{
+    // src is in little endian order at this point
+    SKuint64 v = 0;
+    for (SKuint32 k = m_size; k > 0; --k)
+        v = v << 8 | src[k - 1];
+
+    char* const end = dest + m_field;
+    skMemset(dest, ' ', m_field);
+
+    switch (m_type)
+    {
+    case WT_U16:
+    case WT_U32:
+    case WT_U64:
+        writeDigits(end, v);
+        break;
+    case WT_I16:
+    case WT_I32:
+    case WT_I64:
+    {
+        // sign extend from the word size
+        const SKuint32 shift = 64 - 8 * m_size;
+        formatSigned(end, (SKint64)(v << shift) >> shift);
+        break;
+    }
+    case WT_F32:
+    case WT_F64:
+    {
+        char   buf[32];
+        double d;
+        if (m_type == WT_F32)
+        {
+            float f;
+            SKuint32 bits = (SKuint32)v;
+            memcpy(&f, &bits, 4);
+            d = f;
+        }
+        else
+            memcpy(&d, &v, 8);
+
+        const int n = skSprintf(buf, sizeof buf, "%.*g", m_type == WT_F32 ? 9 : 17, d);
+        if (n > 0 && (SKuint32)n <= m_field)
+            memcpy(end - n, buf, (SKsize)n);
+        break;
+    }
+    default:
+        break;
+    }
+    return end;
+}
+
+SKsize WordFormatter::formatLine(char* dest, const SKuint8* data, SKuint32 len, SKuint64 address) const
+{
+    char* const start = dest;
+    SKuint8     swapped[HexFormatter::MaxWidth];
+    SKuint32    i;
+
+    len = skMin(len, m_width);
+
+    if (m_flags & PF_ADDRESS)
+    {
+        int digits = m_flags & PF_FULLADDR ? 16 : 8;
+        while (digits-- > 0)
+            *dest++ = HexDigits[(address >> (digits * 4)) & 15];
+        *dest++ = ' ';
+    }
+
+    const SKuint32 words = len / m_size;
+    const SKuint8* src   = data;
+    if (m_bigEndian)
+    {
+        swap(swapped, data, words * m_size);
+        src = swapped;
+    }
+
+    for (i = 0; i < words; ++i)
+    {
+        *dest++ = ' ';
+        dest    = formatWord(dest, src + i * m_size);
+    }
+
+    // bytes that do not fill a word
+    for (i = words * m_size; i < len; ++i)
+    {
+        *dest++ = ' ';
+        *dest++ = HexDigits[data[i] >> 4];
+        *dest++ = HexDigits[data[i] & 15];
+    }
+
+    if (m_flags & PF_ASCII)
+    {
+        // pad short lines so that the ASCII column stays aligned
+        const SKuint32 fill = (m_width / m_size - words) * (m_field + 1) - (len - words * m_size) * 3;
+        skMemset(dest, ' ', fill + 2);
+        dest += fill + 2;
+
+        *dest++ = '|';
+        for (i = 0; i < len; ++i)
+            *dest++ = data[i] >= 32 && data[i] < 127 ? (char)data[i] : '.';
+        *dest++ = '|';
+    }
+
+    *dest++ = '\n';
+    return (SKsize)(dest - start);
+}
+
+void WordFormatter::format(OutputBuffer& out, const SKuint8* data, SKsize len, SKuint64 address) const
+{
+    for (SKsize i = 0; i < len; i += m_width)
+    {
+        const SKuint32 n = (SKuint32)skMin<SKsize>(m_width, len - i);
+
+        char* dest = out.reserve(m_lineSize);
+        out.commit(formatLine(dest, data + i, n, address + i));
+    }
+}
@@ -0,0 +1,88 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _hpWordFormatter_h_
+#define _hpWordFormatter_h_
+
+#include "Utils/skString.h"
+
+class OutputBuffer;
+
+enum WordTypes
+{
+    WT_U16 = 0,
+    WT_U32,
+    WT_U64,
+    WT_I16,
+    WT_I32,
+    WT_I64,
+    WT_F32,
+    WT_F64,
+    WT_MAX
+};
+
+// Prints each line as 2, 4 or 8 byte words decoded as integers or floats.
+// Big endian words are swapped 16 bytes at a time with SIMD shuffles where
+// the target supports them, and integers are converted two digits at a time
+// from a lookup table.
+class WordFormatter
+{
+private:
+    SKuint32 m_flags;
+    SKuint32 m_width;
+    SKuint32 m_type;
+    SKuint32 m_size;
+    SKuint32 m_field;
+    bool     m_bigEndian;
+    SKsize   m_lineSize;
+
+    void swap(SKuint8* dest, const SKuint8* src, SKuint32 len) const;
+
+    char* formatWord(char* dest, const SKuint8* src) const;
+
+public:
+    WordFormatter(SKuint32 flags, SKuint32 width, SKuint32 type, bool bigEndian);
+
+    // Returns the WordTypes value for names such as u32 or f64, or WT_MAX.
+    static SKuint32 findType(const char* name);
+
+    // Writes the decimal digits of v so that they end at end,
+    // and returns the first character written.
+    static char* formatUnsigned(char* end, SKuint64 v);
+
+    static char* formatSigned(char* end, SKint64 v);
+
+    SKuint32 getWidth() const
+    {
+        return m_width;
+    }
+
+    SKsize getLineSize() const
+    {
+        return m_lineSize;
+    }
+
+    // Writes one line of at most width bytes. Bytes that do not fill a
+    // whole word are written as hex.
+    SKsize formatLine(char* dest, const SKuint8* data, SKuint32 len, SKuint64 address) const;
+
+    void format(OutputBuffer& out, const SKuint8* data, SKsize len, SKuint64 address) const;
+};
+
+#endif  //_hpWordFormatter_h_
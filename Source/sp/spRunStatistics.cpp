@@ -0,0 +1,120 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "spRunStatistics.h"
+#include <cmath>
+#include "Utils/skMemoryUtils.h"
+
+SKuint16 RunStatistics::Classes[256];
+double   RunStatistics::Weights[256];
+
+RunStatistics::RunStatistics() :
+    m_length(0),
+    m_seen(0),
+    m_sum(0)
+{
+    skMemset(m_counts, 0, sizeof(m_counts));
+}
+
+void RunStatistics::initialize()
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        SKuint16 cls = EX_HEX_LOWER | EX_HEX_UPPER | EX_BASE64;
+        if (i >= 'a' && i <= 'z')
+            cls |= CC_LOWER;
+        else if (i >= 'A' && i <= 'Z')
+            cls |= CC_UPPER;
+        else if (i >= '0' && i <= '9')
+            cls |= CC_DIGIT;
+        else
+            cls |= CC_SYMBOL;
+
+        if (i >= '0' && i <= '9')
+            cls &= ~(EX_HEX_LOWER | EX_HEX_UPPER);
+        else if (i >= 'a' && i <= 'f')
+            cls &= ~EX_HEX_LOWER;
+        else if (i >= 'A' && i <= 'F')
+            cls &= ~EX_HEX_UPPER;
+
+        if (cls & (CC_LOWER | CC_UPPER | CC_DIGIT) ||
+            i == '+' || i == '/' || i == '=' || i == '_' || i == '-')
+            cls &= ~EX_BASE64;
+
+        Classes[i] = cls;
+        Weights[i] = slowWeight((SKuint32)i);
+    }
+}
+
+double RunStatistics::slowWeight(SKuint32 count)
+{
+    return count > 1 ? double(count) * log2(double(count)) : 0.0;
+}
+
+void RunStatistics::reset()
+{
+    skMemset(m_counts, 0, sizeof(m_counts));
+    m_length = 0;
+    m_seen   = 0;
+    m_sum    = 0;
+}
+
+double RunStatistics::entropy() const
+{
+    if (m_length == 0)
+        return 0;
+
+    // H = log2(n) - sum(c * log2(c)) / n
+    const double n = double(m_length);
+    return skMax(log2(n) - m_sum / n, 0.0);
+}
+
+double RunStatistics::relativeEntropy() const
+{
+    double alphabet = 95;
+    const SKuint32 classes = getClasses();
+    if (classes & CC_HEX)
+        alphabet = 16;
+    else if (classes & CC_BASE64)
+        alphabet = 64;
+
+    const double most = log2(skMin(alphabet, double(m_length)));
+    return most > 0 ? entropy() / most : 0;
+}
+
+SKuint32 RunStatistics::getClasses() const
+{
+    SKuint32 classes = m_seen & (CC_LOWER | CC_UPPER | CC_DIGIT | CC_SYMBOL);
+    if (!(m_seen & EX_HEX_LOWER) || !(m_seen & EX_HEX_UPPER))
+        classes |= CC_HEX;
+    if (!(m_seen & EX_BASE64))
+        classes |= CC_BASE64;
+    return classes;
+}
+
+SKuint32 RunStatistics::getClassCount() const
+{
+    SKuint32 count = 0;
+    for (SKuint32 cls = CC_LOWER; cls <= CC_SYMBOL; cls <<= 1)
+    {
+        if (m_seen & cls)
+            ++count;
+    }
+    return count;
+}
@@ -0,0 +1,99 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _spRunStatistics_h_
+#define _spRunStatistics_h_
+
+#include "Utils/skString.h"
+
+// Character statistics that are updated one byte at a time while a run
+// is being collected, so the entropy of the run is known the moment it
+// ends without another pass over it.
+class RunStatistics
+{
+public:
+    enum CharClass
+    {
+        CC_LOWER  = 0x01,
+        CC_UPPER  = 0x02,
+        CC_DIGIT  = 0x04,
+        CC_SYMBOL = 0x08,
+        CC_HEX    = 0x10,  // only [0-9a-f] or only [0-9A-F]
+        CC_BASE64 = 0x20,  // only [0-9A-Za-z+/=_-]
+    };
+
+private:
+    enum Exclusions
+    {
+        EX_HEX_LOWER = 0x40,
+        EX_HEX_UPPER = 0x80,
+        EX_BASE64    = 0x100,
+    };
+
+    SKuint32 m_counts[256];
+    SKuint32 m_length;
+    SKuint32 m_seen;
+    double   m_sum;
+
+    static SKuint16 Classes[256];
+    static double   Weights[256];
+
+    SK_INLINE static double weight(SKuint32 count)
+    {
+        return count < 256 ? Weights[count] : slowWeight(count);
+    }
+
+    static double slowWeight(SKuint32 count);
+
+public:
+    RunStatistics();
+
+    // Fills the lookup tables, must be called once before use.
+    static void initialize();
+
+    void reset();
+
+    SK_INLINE void push(const SKuint8 ch)
+    {
+        // sum(c * log2(c)) only changes by the term of ch
+        const SKuint32 c = m_counts[ch]++;
+        m_sum += weight(c + 1) - weight(c);
+
+        m_seen |= Classes[ch];
+        ++m_length;
+    }
+
+    // Shannon entropy in bits per character.
+    double entropy() const;
+
+    // The entropy of the run relative to the most it could have for
+    // its length over the smallest alphabet it fits in.
+    double relativeEntropy() const;
+
+    SKuint32 getClasses() const;
+
+    SKuint32 getClassCount() const;
+
+    SK_INLINE SKuint32 getLength() const
+    {
+        return m_length;
+    }
+};
+
+#endif  //_spRunStatistics_h_
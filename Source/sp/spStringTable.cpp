@@ -0,0 +1,414 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "spStringTable.h"
+#include <algorithm>
+#include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
+
+const SKuint32 InitialSlots = 1 << 12;
+const SKuint32 EmptySlot    = SK_NPOS32;
+
+static int compareStrings(const char* a, SKuint32 al, const char* b, SKuint32 bl)
+{
+    const int rc = memcmp(a, b, skMin(al, bl));
+    if (rc != 0)
+        return rc;
+    return al < bl ? -1 : al > bl ? 1 : 0;
+}
+
+StringTable::StringTable(SKsize budget) :
+    m_chars(nullptr),
+    m_charSize(0),
+    m_charCapacity(0),
+    m_entries(nullptr),
+    m_entrySize(0),
+    m_entryCapacity(0),
+    m_slots(nullptr),
+    m_slotCapacity(0),
+    m_budget(budget),
+    m_runs(nullptr),
+    m_runSize(0),
+    m_runCapacity(0)
+{
+    rehash(InitialSlots);
+}
+
+StringTable::~StringTable()
+{
+    for (SKuint32 i = 0; i < m_runSize; ++i)
+        fclose(m_runs[i]);
+
+    delete[] m_runs;
+    delete[] m_slots;
+    delete[] m_entries;
+    delete[] m_chars;
+}
+
+SKuint64 StringTable::hash(const char* str, SKuint32 len)
+{
+    const SKuint64 k = 0x9E3779B97F4A7C15ull;
+
+    SKuint64 h = k ^ len, w;
+    SKuint32 i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        memcpy(&w, str + i, 8);
+        h = (h ^ w) * k;
+        h ^= h >> 29;
+    }
+
+    w = 0;
+    if (i < len)
+        memcpy(&w, str + i, len - i);
+
+    h = (h ^ w) * k;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ull;
+    h ^= h >> 32;
+    return h;
+}
+
+void StringTable::clear()
+{
+    m_charSize  = 0;
+    m_entrySize = 0;
+    skMemset(m_slots, 0xFF, sizeof(SKuint32) * m_slotCapacity);
+}
+
+void StringTable::rehash(SKuint32 capacity)
+{
+    delete[] m_slots;
+    m_slots        = new SKuint32[capacity];
+    m_slotCapacity = capacity;
+    skMemset(m_slots, 0xFF, sizeof(SKuint32) * capacity);
+
+    const SKuint32 mask = capacity - 1;
+    for (SKuint32 i = 0; i < m_entrySize; ++i)
+    {
+        SKuint32 s = (SKuint32)m_entries[i].hash & mask;
+        while (m_slots[s] != EmptySlot)
+            s = (s + 1) & mask;
+        m_slots[s] = i;
+    }
+
+    if (m_entryCapacity < capacity / 2)
+    {
+        Entry* entries = new Entry[capacity / 2];
+        if (m_entries)
+            memcpy(entries, m_entries, sizeof(Entry) * m_entrySize);
+
+        delete[] m_entries;
+        m_entries       = entries;
+        m_entryCapacity = capacity / 2;
+    }
+}
+
+void StringTable::reserveChars(SKsize len)
+{
+    if (m_charSize + len <= m_charCapacity)
+        return;
+
+    SKsize capacity = skMax<SKsize>(m_charCapacity * 2, 1 << 16);
+    while (capacity < m_charSize + len)
+        capacity *= 2;
+
+    char* chars = new char[capacity];
+    if (m_chars)
+        memcpy(chars, m_chars, m_charSize);
+
+    delete[] m_chars;
+    m_chars        = chars;
+    m_charCapacity = capacity;
+}
+
+SKsize StringTable::memoryInUse() const
+{
+    // Counts the bytes that are actually held, each entry owns at
+    // least two slots at the maximum load factor.
+    return m_charSize + (SKsize)m_entrySize * (sizeof(Entry) + 2 * sizeof(SKuint32));
+}
+
+void StringTable::insert(const char* str, SKuint32 len, SKuint64 address)
+{
+    const SKuint64 h    = hash(str, len);
+    const SKuint32 mask = m_slotCapacity - 1;
+
+    SKuint32 s = (SKuint32)h & mask;
+    while (m_slots[s] != EmptySlot)
+    {
+        Entry& ent = m_entries[m_slots[s]];
+        if (ent.hash == h && ent.length == len &&
+            memcmp(m_chars + ent.offset, str, len) == 0)
+        {
+            ent.count++;
+            ent.last = address;
+            return;
+        }
+        s = (s + 1) & mask;
+    }
+
+    if (memoryInUse() + len > m_budget && m_entrySize > 0)
+    {
+        if (spill())
+        {
+            insert(str, len, address);
+            return;
+        }
+    }
+
+    reserveChars(len);
+
+    Entry& ent = m_entries[m_entrySize];
+    ent.hash   = h;
+    ent.count  = 1;
+    ent.first  = address;
+    ent.last   = address;
+    ent.offset = m_charSize;
+    ent.length = len;
+
+    memcpy(m_chars + m_charSize, str, len);
+    m_charSize += len;
+    m_slots[s] = m_entrySize++;
+
+    // keep the load factor at or below one half
+    if (m_entrySize >= m_slotCapacity / 2)
+        rehash(m_slotCapacity * 2);
+}
+
+void StringTable::sortEntries()
+{
+    const char* chars = m_chars;
+    std::sort(m_entries,
+              m_entries + m_entrySize,
+              [chars](const Entry& a, const Entry& b) {
+                  return compareStrings(chars + a.offset,
+                                        a.length,
+                                        chars + b.offset,
+                                        b.length) < 0;
+              });
+}
+
+bool StringTable::spill()
+{
+    FILE* fp = tmpfile();
+    if (!fp)
+    {
+        skLogd(LD_ERROR, "failed to create a temporary run file, continuing in memory\n");
+        m_budget = SK_NPOS;
+        return false;
+    }
+
+    sortEntries();
+
+    for (SKuint32 i = 0; i < m_entrySize; ++i)
+    {
+        const Entry& ent = m_entries[i];
+        fwrite(&ent.length, sizeof(SKuint32), 1, fp);
+        fwrite(&ent.count, sizeof(SKuint64), 1, fp);
+        fwrite(&ent.first, sizeof(SKuint64), 1, fp);
+        fwrite(&ent.last, sizeof(SKuint64), 1, fp);
+        fwrite(m_chars + ent.offset, 1, ent.length, fp);
+    }
+    rewind(fp);
+
+    if (m_runSize + 1 > m_runCapacity)
+    {
+        const SKuint32 capacity = skMax<SKuint32>(m_runCapacity * 2, 16);
+
+        Run* runs = new Run[capacity];
+        if (m_runs)
+            memcpy(runs, m_runs, sizeof(Run) * m_runSize);
+
+        delete[] m_runs;
+        m_runs        = runs;
+        m_runCapacity = capacity;
+    }
+
+    m_runs[m_runSize++] = fp;
+    clear();
+    return true;
+}
+
+void StringTable::finalize(Visitor visitor, void* user)
+{
+    if (m_runSize == 0)
+    {
+        sortEntries();
+
+        for (SKuint32 i = 0; i < m_entrySize; ++i)
+        {
+            const Entry& ent = m_entries[i];
+            visitor(user,
+                    m_chars + ent.offset,
+                    ent.length,
+                    ent.count,
+                    ent.first,
+                    ent.last);
+        }
+    }
+    else
+    {
+        if (m_entrySize > 0)
+            spill();
+        merge(visitor, user);
+    }
+    clear();
+}
+
+class RunReader
+{
+public:
+    FILE*    m_fp;
+    char*    m_str;
+    SKuint32 m_capacity;
+    SKuint32 m_length;
+    SKuint64 m_count;
+    SKuint64 m_first;
+    SKuint64 m_last;
+
+    RunReader() :
+        m_fp(nullptr),
+        m_str(nullptr),
+        m_capacity(0),
+        m_length(0),
+        m_count(0),
+        m_first(0),
+        m_last(0)
+    {
+    }
+
+    ~RunReader()
+    {
+        delete[] m_str;
+    }
+
+    bool next()
+    {
+        if (fread(&m_length, sizeof(SKuint32), 1, m_fp) != 1)
+            return false;
+
+        if (m_length > m_capacity)
+        {
+            delete[] m_str;
+            m_capacity = skMax<SKuint32>(m_length, 64);
+            m_str      = new char[m_capacity];
+        }
+
+        bool rc = fread(&m_count, sizeof(SKuint64), 1, m_fp) == 1;
+        rc      = rc && fread(&m_first, sizeof(SKuint64), 1, m_fp) == 1;
+        rc      = rc && fread(&m_last, sizeof(SKuint64), 1, m_fp) == 1;
+        rc      = rc && fread(m_str, 1, m_length, m_fp) == m_length;
+        return rc;
+    }
+
+    bool less(const RunReader& rhs) const
+    {
+        const int rc = compareStrings(m_str, m_length, rhs.m_str, rhs.m_length);
+        if (rc != 0)
+            return rc < 0;
+        return m_first < rhs.m_first;
+    }
+};
+
+void StringTable::merge(Visitor visitor, void* user)
+{
+    RunReader* readers = new RunReader[m_runSize];
+    SKuint32*  heap    = new SKuint32[m_runSize];
+    SKuint32   size    = 0, i;
+
+    const auto siftDown = [readers, heap](SKuint32 n, SKuint32 size) {
+        for (;;)
+        {
+            SKuint32       m = n;
+            const SKuint32 l = 2 * n + 1, r = l + 1;
+            if (l < size && readers[heap[l]].less(readers[heap[m]]))
+                m = l;
+            if (r < size && readers[heap[r]].less(readers[heap[m]]))
+                m = r;
+            if (m == n)
+                break;
+            std::swap(heap[n], heap[m]);
+            n = m;
+        }
+    };
+
+    for (i = 0; i < m_runSize; ++i)
+    {
+        readers[i].m_fp = m_runs[i];
+        if (readers[i].next())
+            heap[size++] = i;
+    }
+
+    for (i = size; i > 0; --i)
+        siftDown(i - 1, size);
+
+    // The accumulated string is held apart from the readers since
+    // advancing a reader overwrites its buffer.
+    char*    str      = nullptr;
+    SKuint32 capacity = 0, length = 0;
+    SKuint64 count = 0, first = 0, last = 0;
+    bool     active = false;
+
+    while (size > 0)
+    {
+        RunReader& top = readers[heap[0]];
+
+        if (active && compareStrings(str, length, top.m_str, top.m_length) == 0)
+        {
+            count += top.m_count;
+            first = skMin(first, top.m_first);
+            last  = skMax(last, top.m_last);
+        }
+        else
+        {
+            if (active)
+                visitor(user, str, length, count, first, last);
+
+            if (top.m_length > capacity)
+            {
+                delete[] str;
+                capacity = skMax<SKuint32>(top.m_length, 64);
+                str      = new char[capacity];
+            }
+
+            memcpy(str, top.m_str, top.m_length);
+            length = top.m_length;
+            count  = top.m_count;
+            first  = top.m_first;
+            last   = top.m_last;
+            active = true;
+        }
+
+        if (!top.next())
+            heap[0] = heap[--size];
+        siftDown(0, size);
+    }
+
+    if (active)
+        visitor(user, str, length, count, first, last);
+
+    for (i = 0; i < m_runSize; ++i)
+        fclose(m_runs[i]);
+    m_runSize = 0;
+
+    delete[] str;
+    delete[] heap;
+    delete[] readers;
+}
@@ -0,0 +1,93 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _spStringTable_h_
+#define _spStringTable_h_
+
+#include <cstdio>
+#include "Utils/skString.h"
+
+// Open addressed table of distinct strings. Each entry records the number
+// of times the string was seen along with its first and last address.
+// When the memory in use grows past the budget, the entries are sorted and
+// spilled to a temporary run file. The runs are merged in finalize.
+class StringTable
+{
+public:
+    struct Entry
+    {
+        SKuint64 hash;
+        SKuint64 count;
+        SKuint64 first;
+        SKuint64 last;
+        SKsize   offset;
+        SKuint32 length;
+    };
+
+    // Called once for every distinct string in ascending byte order.
+    typedef void (*Visitor)(void*       user,
+                            const char* str,
+                            SKuint32    len,
+                            SKuint64    count,
+                            SKuint64    first,
+                            SKuint64    last);
+
+private:
+    typedef FILE* Run;
+
+    char*     m_chars;
+    SKsize    m_charSize;
+    SKsize    m_charCapacity;
+    Entry*    m_entries;
+    SKuint32  m_entrySize;
+    SKuint32  m_entryCapacity;
+    SKuint32* m_slots;
+    SKuint32  m_slotCapacity;
+    SKsize    m_budget;
+    Run*      m_runs;
+    SKuint32  m_runSize;
+    SKuint32  m_runCapacity;
+
+    void clear();
+
+    void rehash(SKuint32 capacity);
+
+    void reserveChars(SKsize len);
+
+    SKsize memoryInUse() const;
+
+    void sortEntries();
+
+    bool spill();
+
+    void merge(Visitor visitor, void* user);
+
+public:
+    explicit StringTable(SKsize budget);
+    ~StringTable();
+
+    void insert(const char* str, SKuint32 len, SKuint64 address);
+
+    // Visits every distinct string then resets the table.
+    void finalize(Visitor visitor, void* user);
+
+    static SKuint64 hash(const char* str, SKuint32 len);
+};
+
+#endif  //_spStringTable_h_
@@ -0,0 +1,453 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "spSuffixArray.h"
+#include "Utils/skFileStream.h"
+#include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
+
+const SKuint32 Version = 1;
+
+// SA-IS (Nong, Zhang & Chan) with the type array packed into bits. The
+// reduced problem is stored in the upper half of the suffix array, so
+// apart from the output the memory needed is n / 8 bytes plus the buckets.
+// The index type I is SKuint32 unless the range passes 4 GiB.
+namespace SAIS
+{
+    template <typename I>
+    struct Index
+    {
+        static const I Empty = (I)-1;
+    };
+
+    // The input bytes are shifted up by one so that a virtual sentinel
+    // can be placed at the last index.
+    template <typename I>
+    struct ByteString
+    {
+        const SKuint8* data;
+        I              last;
+
+        SK_INLINE I operator[](const I i) const
+        {
+            return i < last ? I(data[i]) + 1 : 0;
+        }
+    };
+
+    template <typename I>
+    struct IntString
+    {
+        const I* data;
+
+        SK_INLINE I operator[](const I i) const
+        {
+            return data[i];
+        }
+    };
+
+    template <typename I>
+    SK_INLINE bool isS(const SKuint8* t, const I i)
+    {
+        return (t[i >> 3] & (1 << (i & 7))) != 0;
+    }
+
+    template <typename I>
+    SK_INLINE void setS(SKuint8* t, const I i, const bool v)
+    {
+        if (v)
+            t[i >> 3] |= (SKuint8)(1 << (i & 7));
+        else
+            t[i >> 3] &= (SKuint8) ~(1 << (i & 7));
+    }
+
+    template <typename I>
+    SK_INLINE bool isLMS(const SKuint8* t, const I i)
+    {
+        return i != Index<I>::Empty && i > 0 && isS(t, i) && !isS(t, i - 1);
+    }
+
+    template <typename I, typename S>
+    void getBuckets(const S& s, I* bkt, I n, I k, bool end)
+    {
+        I i, sum = 0;
+        skMemset(bkt, 0, sizeof(I) * (k + 1));
+
+        for (i = 0; i < n; ++i)
+            bkt[s[i]]++;
+
+        for (i = 0; i <= k; ++i)
+        {
+            sum += bkt[i];
+            bkt[i] = end ? sum : sum - bkt[i];
+        }
+    }
+
+    template <typename I, typename S>
+    void induceL(const SKuint8* t, I* sa, const S& s, I* bkt, I n, I k)
+    {
+        getBuckets(s, bkt, n, k, false);
+        for (I i = 0; i < n; ++i)
+        {
+            const I j = sa[i];
+            if (j != Index<I>::Empty && j > 0 && !isS(t, j - 1))
+                sa[bkt[s[j - 1]]++] = j - 1;
+        }
+    }
+
+    template <typename I, typename S>
+    void induceS(const SKuint8* t, I* sa, const S& s, I* bkt, I n, I k)
+    {
+        getBuckets(s, bkt, n, k, true);
+        for (I i = n; i-- > 0;)
+        {
+            const I j = sa[i];
+            if (j != Index<I>::Empty && j > 0 && isS(t, j - 1))
+                sa[--bkt[s[j - 1]]] = j - 1;
+        }
+    }
+
+    // s[n - 1] must be the unique smallest symbol, and k the largest symbol.
+    template <typename I, typename S>
+    void sort(const S& s, I* sa, const I n, const I k)
+    {
+        const I Empty = Index<I>::Empty;
+
+        I i, j;
+
+        SKuint8* t = new SKuint8[n / 8 + 1];
+        skMemset(t, 0, n / 8 + 1);
+
+        setS(t, n - 1, true);
+        for (i = n - 1; i-- > 0;)
+            setS(t, i, s[i] < s[i + 1] || (s[i] == s[i + 1] && isS(t, i + 1)));
+
+        // Sort the LMS substrings
+        I* bkt = new I[k + 1];
+        getBuckets(s, bkt, n, k, true);
+
+        skMemset(sa, 0xFF, sizeof(I) * n);
+        for (i = 1; i < n; ++i)
+        {
+            if (isLMS(t, i))
+                sa[--bkt[s[i]]] = i;
+        }
+
+        induceL(t, sa, s, bkt, n, k);
+        induceS(t, sa, s, bkt, n, k);
+
+        // Compact the sorted LMS substrings into the front.
+        I n1 = 0;
+        for (i = 0; i < n; ++i)
+        {
+            if (isLMS(t, sa[i]))
+                sa[n1++] = sa[i];
+        }
+
+        // Name them, storing each name at n1 + pos / 2.
+        skMemset(sa + n1, 0xFF, sizeof(I) * (n - n1));
+
+        I name = 0, prev = Empty;
+        for (i = 0; i < n1; ++i)
+        {
+            const I pos  = sa[i];
+            bool    diff = false;
+
+            for (I d = 0; d < n; ++d)
+            {
+                if (prev == Empty ||
+                    s[pos + d] != s[prev + d] ||
+                    isS(t, pos + d) != isS(t, prev + d))
+                {
+                    diff = true;
+                    break;
+                }
+                if (d > 0 && (isLMS(t, pos + d) || isLMS(t, prev + d)))
+                    break;
+            }
+
+            if (diff)
+            {
+                ++name;
+                prev = pos;
+            }
+            sa[n1 + pos / 2] = name - 1;
+        }
+
+        for (i = n, j = n; i-- > n1;)
+        {
+            if (sa[i] != Empty)
+                sa[--j] = sa[i];
+        }
+
+        // Solve the reduced problem.
+        I* sa1 = sa;
+        I* s1  = sa + n - n1;
+        if (name < n1)
+            sort(IntString<I>{s1}, sa1, n1, name - 1);
+        else
+        {
+            for (i = 0; i < n1; ++i)
+                sa1[s1[i]] = i;
+        }
+
+        // Induce the final order from the sorted LMS suffixes.
+        getBuckets(s, bkt, n, k, true);
+        for (i = 1, j = 0; i < n; ++i)
+        {
+            if (isLMS(t, i))
+                s1[j++] = i;
+        }
+
+        for (i = 0; i < n1; ++i)
+            sa1[i] = s1[sa1[i]];
+
+        skMemset(sa + n1, 0xFF, sizeof(I) * (n - n1));
+        for (i = n1; i-- > 0;)
+        {
+            j     = sa[i];
+            sa[i] = Empty;
+            sa[--bkt[s[j]]] = j;
+        }
+
+        induceL(t, sa, s, bkt, n, k);
+        induceS(t, sa, s, bkt, n, k);
+
+        delete[] bkt;
+        delete[] t;
+    }
+
+    // Sorts the suffixes of data[base, base + length) into sa, storing
+    // them as absolute offsets. sa must hold length + 1 entries.
+    template <typename I>
+    void build(const SKuint8* data, I* sa, I base, I length)
+    {
+        // One extra slot is needed for the sentinel suffix, it
+        // always sorts first and is dropped afterwards.
+        sort(ByteString<I>{data + base, length}, sa, length + 1, (I)256);
+
+        for (I i = 0; i < length; ++i)
+            sa[i] = sa[i + 1] + base;
+    }
+
+    template <typename I>
+    SKuint64 filter(I* sa, SKuint64 count, SKuint64 base, const SKuint8* mask)
+    {
+        SKuint64 i, j;
+        for (i = 0, j = 0; i < count; ++i)
+        {
+            const SKuint64 rel = sa[i] - base;
+            if (mask[rel >> 3] & (1 << (rel & 7)))
+                sa[j++] = sa[i];
+        }
+        return j;
+    }
+}  // namespace SAIS
+
+SuffixArray::SuffixArray() :
+    m_index(nullptr),
+    m_view(nullptr),
+    m_count(0),
+    m_flags(0),
+    m_fileSize(0),
+    m_base(0),
+    m_length(0)
+{
+}
+
+SuffixArray::~SuffixArray()
+{
+    clear();
+}
+
+void SuffixArray::clear()
+{
+    delete[] m_index;
+    m_sidecar.close();
+
+    m_index    = nullptr;
+    m_view     = nullptr;
+    m_count    = 0;
+    m_flags    = 0;
+    m_fileSize = 0;
+    m_base     = 0;
+    m_length   = 0;
+}
+
+SKsize SuffixArray::entrySize() const
+{
+    return m_flags & SA_WIDE ? sizeof(SKuint64) : sizeof(SKuint32);
+}
+
+bool SuffixArray::build(const SKuint8* data,
+                        SKuint64       fileSize,
+                        SKuint64       base,
+                        SKuint64       length)
+{
+    clear();
+    if (base > fileSize || length > fileSize - base)
+    {
+        skLogd(LD_ERROR, "the range is outside of the file\n");
+        return false;
+    }
+
+    m_fileSize = fileSize;
+    m_base     = base;
+    m_length   = length;
+    if (length == 0)
+        return true;
+
+    // The offsets, and the sentinel past the last one, must stay below
+    // the empty marker of the 32 bit sort.
+    if (base + length >= SK_NPOS32 - 1)
+    {
+        m_flags |= SA_WIDE;
+
+        SKuint64* sa = new SKuint64[length + 1];
+        SAIS::build<SKuint64>(data, sa, base, length);
+        m_index = (SKuint8*)sa;
+    }
+    else
+    {
+        SKuint32* sa = new SKuint32[(SKsize)length + 1];
+        SAIS::build<SKuint32>(data, sa, (SKuint32)base, (SKuint32)length);
+        m_index = (SKuint8*)sa;
+    }
+
+    m_view  = m_index;
+    m_count = length;
+    return true;
+}
+
+void SuffixArray::filter(const SKuint8* mask, SKuint32 flags)
+{
+    if (m_flags & SA_WIDE)
+        m_count = SAIS::filter((SKuint64*)m_index, m_count, m_base, mask);
+    else
+        m_count = SAIS::filter((SKuint32*)m_index, m_count, m_base, mask);
+    m_flags |= flags;
+}
+
+bool SuffixArray::save(const char* path) const
+{
+    skFileStream fp;
+    fp.open(path, skStream::WRITE);
+    if (!fp.isOpen())
+    {
+        skLogf(LD_ERROR, "Failed to open file %s\n", path);
+        return false;
+    }
+
+    Header header;
+    skMemset(&header, 0, sizeof(Header));
+    memcpy(header.magic, "SPSA", 4);
+    header.version  = Version;
+    header.flags    = m_flags;
+    header.fileSize = m_fileSize;
+    header.base     = m_base;
+    header.length   = m_length;
+    header.count    = m_count;
+
+    const SKsize size = entrySize() * (SKsize)m_count;
+
+    bool rc = fp.write(&header, sizeof(Header)) == sizeof(Header);
+    rc      = rc && fp.write(m_view, size) == size;
+    if (!rc)
+        skLogf(LD_ERROR, "Failed to write %s\n", path);
+    return rc;
+}
+
+bool SuffixArray::load(const char* path)
+{
+    clear();
+    if (!m_sidecar.open(path))
+    {
+        skLogf(LD_ERROR, "Failed to open file %s\n", path);
+        return false;
+    }
+
+    Header header;
+    if (m_sidecar.getSize() < sizeof(Header))
+    {
+        skLogf(LD_ERROR, "%s is not an index file\n", path);
+        return false;
+    }
+
+    memcpy(&header, m_sidecar.getData(), sizeof(Header));
+    if (memcmp(header.magic, "SPSA", 4) != 0 || header.version != Version)
+    {
+        skLogf(LD_ERROR, "%s is not an index file\n", path);
+        return false;
+    }
+
+    m_flags = header.flags;
+    if (m_sidecar.getSize() < sizeof(Header) + header.count * entrySize())
+    {
+        skLogf(LD_ERROR, "%s is truncated\n", path);
+        return false;
+    }
+
+    m_view     = m_sidecar.getData() + sizeof(Header);
+    m_count    = header.count;
+    m_fileSize = header.fileSize;
+    m_base     = header.base;
+    m_length   = header.length;
+    return true;
+}
+
+int SuffixArray::compare(const SKuint8* data,
+                         SKuint64       pos,
+                         const SKuint8* pattern,
+                         SKuint32       len) const
+{
+    const SKuint64 avail = m_base + m_length - pos;
+
+    const int rc = memcmp(data + pos, pattern, (SKsize)skMin<SKuint64>(avail, len));
+    if (rc != 0)
+        return rc;
+    return avail < len ? -1 : 0;
+}
+
+SKuint64 SuffixArray::find(const SKuint8* data,
+                           const SKuint8* pattern,
+                           SKuint32       len,
+                           SKuint64&      first) const
+{
+    SKuint64 lo = 0, hi = m_count, mid;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (compare(data, at(mid), pattern, len) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    first = lo;
+
+    hi = m_count;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (compare(data, at(mid), pattern, len) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo - first;
+}
@@ -0,0 +1,119 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _spSuffixArray_h_
+#define _spSuffixArray_h_
+
+#include "Utils/skString.h"
+#include "mappedFile.h"
+
+// Suffix array over a range of a file. The entries are absolute file
+// offsets sorted by the bytes that follow them, so every occurrence of a
+// byte sequence is found with two binary searches. Entries are 32 bits
+// unless the range ends past 4 GiB, in which case they are 64 bits and
+// the index is flagged SA_WIDE.
+class SuffixArray
+{
+public:
+    enum Flags
+    {
+        SA_STRINGS = 0x01,
+        SA_WIDE    = 0x02,
+    };
+
+    struct Header
+    {
+        char     magic[4];
+        SKuint32 version;
+        SKuint32 flags;
+        SKuint32 reserved;
+        SKuint64 fileSize;
+        SKuint64 base;
+        SKuint64 length;
+        SKuint64 count;
+    };
+
+private:
+    SKuint8*       m_index;
+    const SKuint8* m_view;
+    SKuint64       m_count;
+    SKuint32       m_flags;
+    SKuint64       m_fileSize;
+    SKuint64       m_base;
+    SKuint64       m_length;
+    MappedFile     m_sidecar;
+
+    void clear();
+
+    SKsize entrySize() const;
+
+    int compare(const SKuint8* data,
+                SKuint64       pos,
+                const SKuint8* pattern,
+                SKuint32       len) const;
+
+public:
+    SuffixArray();
+    ~SuffixArray();
+
+    // Sorts every suffix of data[base, base + length).
+    bool build(const SKuint8* data,
+               SKuint64       fileSize,
+               SKuint64       base,
+               SKuint64       length);
+
+    // Drops the entries whose bit is clear in mask, where
+    // bit i corresponds to the address base + i.
+    void filter(const SKuint8* mask, SKuint32 flags);
+
+    bool save(const char* path) const;
+
+    bool load(const char* path);
+
+    // Locates the entries that start with pattern. The result is the
+    // number of matches, and first receives the index of the first one.
+    SKuint64 find(const SKuint8* data,
+                  const SKuint8* pattern,
+                  SKuint32       len,
+                  SKuint64&      first) const;
+
+    SK_INLINE SKuint64 at(SKuint64 i) const
+    {
+        if (m_flags & SA_WIDE)
+            return ((const SKuint64*)m_view)[i];
+        return ((const SKuint32*)m_view)[i];
+    }
+
+    SK_INLINE SKuint64 size() const
+    {
+        return m_count;
+    }
+
+    SK_INLINE SKuint32 getFlags() const
+    {
+        return m_flags;
+    }
+
+    SK_INLINE SKuint64 getFileSize() const
+    {
+        return m_fileSize;
+    }
+};
+
+#endif  //_spSuffixArray_h_
@@ -0,0 +1,846 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#include "spTokenDFA.h"
+#include <algorithm>
+#include <bitset>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Utils/skFileStream.h"
+#include "Utils/skLogger.h"
+#include "Utils/skMemoryUtils.h"
+
+const SKuint32 MaxStates = 1 << 16;
+const SKuint32 DeadState = 0;
+const SKuint32 Start     = 1;
+
+namespace
+{
+    typedef std::bitset<256> CharSet;
+
+    struct RegexNode
+    {
+        enum Type
+        {
+            RN_SET,
+            RN_EMPTY,
+            RN_CAT,
+            RN_ALT,
+            RN_REPEAT,
+        };
+
+        Type                    type;
+        CharSet                 set;
+        std::vector<RegexNode*> children;
+        int                     min;
+        int                     max;  // -1 is unbounded
+    };
+
+    class RegexParser
+    {
+    private:
+        const char*                             m_pos;
+        const char*                             m_error;
+        std::vector<std::unique_ptr<RegexNode>> m_nodes;
+
+        RegexNode* make(RegexNode::Type type)
+        {
+            m_nodes.emplace_back(new RegexNode());
+            RegexNode* node = m_nodes.back().get();
+            node->type      = type;
+            node->min       = 0;
+            node->max       = 0;
+            return node;
+        }
+
+        RegexNode* fail(const char* error)
+        {
+            if (!m_error)
+                m_error = error;
+            return nullptr;
+        }
+
+        static int hexValue(char ch)
+        {
+            if (ch >= '0' && ch <= '9')
+                return ch - '0';
+            if (ch >= 'a' && ch <= 'f')
+                return ch - 'a' + 10;
+            if (ch >= 'A' && ch <= 'F')
+                return ch - 'A' + 10;
+            return -1;
+        }
+
+        static void addRange(CharSet& set, int a, int b)
+        {
+            for (int i = a; i <= b; ++i)
+                set.set((size_t)i);
+        }
+
+        // Parses the escape after a backslash into set, returns false on error.
+        bool parseEscape(CharSet& set)
+        {
+            const char ch = *m_pos++;
+            switch (ch)
+            {
+            case 0:
+                --m_pos;
+                return false;
+            case 'd':
+                addRange(set, '0', '9');
+                break;
+            case 'w':
+                addRange(set, '0', '9');
+                addRange(set, 'a', 'z');
+                addRange(set, 'A', 'Z');
+                set.set('_');
+                break;
+            case 's':
+                set.set(' ');
+                addRange(set, '\t', '\r');
+                break;
+            case 'n':
+                set.set('\n');
+                break;
+            case 'r':
+                set.set('\r');
+                break;
+            case 't':
+                set.set('\t');
+                break;
+            case 'x':
+            {
+                const int hi = hexValue(m_pos[0]);
+                const int lo = hi >= 0 ? hexValue(m_pos[1]) : -1;
+                if (lo < 0)
+                    return false;
+                set.set((size_t)(hi << 4 | lo));
+                m_pos += 2;
+                break;
+            }
+            default:
+                set.set((SKuint8)ch);
+                break;
+            }
+            return true;
+        }
+
+        RegexNode* parseClass()
+        {
+            RegexNode* node = make(RegexNode::RN_SET);
+
+            bool negate = false;
+            if (*m_pos == '^')
+            {
+                negate = true;
+                ++m_pos;
+            }
+
+            bool first = true;
+            while (*m_pos && (*m_pos != ']' || first))
+            {
+                first = false;
+
+                CharSet single;
+                if (*m_pos == '\\')
+                {
+                    ++m_pos;
+                    if (!parseEscape(single))
+                        return fail("invalid escape");
+                }
+                else
+                    single.set((SKuint8)*m_pos++);
+
+                // a range needs single characters on both sides
+                if (m_pos[0] == '-' && m_pos[1] && m_pos[1] != ']' && single.count() == 1)
+                {
+                    int lo = 0;
+                    while (!single.test((size_t)lo))
+                        ++lo;
+
+                    ++m_pos;
+                    int hi = (SKuint8)*m_pos++;
+                    if (hi == '\\')
+                    {
+                        CharSet end;
+                        if (!parseEscape(end) || end.count() != 1)
+                            return fail("invalid range");
+                        hi = 0;
+                        while (!end.test((size_t)hi))
+                            ++hi;
+                    }
+                    if (hi < lo)
+                        return fail("invalid range");
+                    addRange(node->set, lo, hi);
+                }
+                else
+                    node->set |= single;
+            }
+
+            if (*m_pos != ']')
+                return fail("missing ]");
+            ++m_pos;
+
+            if (negate)
+                node->set.flip();
+            return node;
+        }
+
+        RegexNode* parseAtom()
+        {
+            RegexNode* node;
+
+            const char ch = *m_pos++;
+            switch (ch)
+            {
+            case '(':
+                node = parseAlternation();
+                if (!node)
+                    return nullptr;
+                if (*m_pos != ')')
+                    return fail("missing )");
+                ++m_pos;
+                return node;
+            case '[':
+                return parseClass();
+            case '.':
+                node = make(RegexNode::RN_SET);
+                node->set.set();
+                node->set.reset('\n');
+                return node;
+            case '\\':
+                node = make(RegexNode::RN_SET);
+                if (!parseEscape(node->set))
+                    return fail("invalid escape");
+                return node;
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+                return fail("nothing to repeat");
+            default:
+                node = make(RegexNode::RN_SET);
+                node->set.set((SKuint8)ch);
+                return node;
+            }
+        }
+
+        bool parseCount(int& value)
+        {
+            if (*m_pos < '0' || *m_pos > '9')
+                return false;
+
+            value = 0;
+            while (*m_pos >= '0' && *m_pos <= '9')
+            {
+                value = value * 10 + (*m_pos++ - '0');
+                if (value > 1024)
+                    return false;
+            }
+            return true;
+        }
+
+        RegexNode* parseRepeat()
+        {
+            RegexNode* node = parseAtom();
+            while (node)
+            {
+                int min, max;
+
+                const char ch = *m_pos;
+                if (ch == '*')
+                    min = 0, max = -1;
+                else if (ch == '+')
+                    min = 1, max = -1;
+                else if (ch == '?')
+                    min = 0, max = 1;
+                else if (ch == '{')
+                {
+                    ++m_pos;
+                    if (!parseCount(min))
+                        return fail("invalid repeat count");
+
+                    max = min;
+                    if (*m_pos == ',')
+                    {
+                        ++m_pos;
+                        if (*m_pos == '}')
+                            max = -1;
+                        else if (!parseCount(max) || max < min)
+                            return fail("invalid repeat count");
+                    }
+                    if (*m_pos != '}')
+                        return fail("missing }");
+                }
+                else
+                    break;
+
+                ++m_pos;
+
+                RegexNode* repeat = make(RegexNode::RN_REPEAT);
+                repeat->min       = min;
+                repeat->max       = max;
+                repeat->children.push_back(node);
+                node = repeat;
+            }
+            return node;
+        }
+
+        RegexNode* parseConcatenation()
+        {
+            RegexNode* node = make(RegexNode::RN_CAT);
+            while (*m_pos && *m_pos != '|' && *m_pos != ')')
+            {
+                RegexNode* child = parseRepeat();
+                if (!child)
+                    return nullptr;
+                node->children.push_back(child);
+            }
+
+            if (node->children.empty())
+                node->type = RegexNode::RN_EMPTY;
+            return node;
+        }
+
+        RegexNode* parseAlternation()
+        {
+            RegexNode* node = parseConcatenation();
+            if (!node || *m_pos != '|')
+                return node;
+
+            RegexNode* alt = make(RegexNode::RN_ALT);
+            alt->children.push_back(node);
+            while (*m_pos == '|')
+            {
+                ++m_pos;
+                node = parseConcatenation();
+                if (!node)
+                    return nullptr;
+                alt->children.push_back(node);
+            }
+            return alt;
+        }
+
+    public:
+        RegexParser() :
+            m_pos(nullptr),
+            m_error(nullptr)
+        {
+        }
+
+        RegexNode* parse(const char* expression)
+        {
+            m_pos   = expression;
+            m_error = nullptr;
+
+            RegexNode* node = parseAlternation();
+            if (node && *m_pos != 0)
+                return fail("unbalanced )");
+            return node;
+        }
+
+        const char* getError() const
+        {
+            return m_error ? m_error : "";
+        }
+
+        SKsize getErrorOffset(const char* expression) const
+        {
+            return (SKsize)(m_pos - expression);
+        }
+    };
+
+    struct NfaState
+    {
+        CharSet          set;
+        int              next;
+        int              accept;
+        std::vector<int> epsilon;
+    };
+
+    // Thompson construction, each fragment has a single entry and exit.
+    class NfaBuilder
+    {
+    public:
+        std::vector<NfaState> m_states;
+
+        int add()
+        {
+            NfaState state;
+            state.next   = -1;
+            state.accept = -1;
+            m_states.push_back(state);
+            return (int)m_states.size() - 1;
+        }
+
+        void link(int from, int to)
+        {
+            m_states[(size_t)from].epsilon.push_back(to);
+        }
+
+        void build(const RegexNode* node, int& start, int& end)
+        {
+            int cs, ce;
+            switch (node->type)
+            {
+            case RegexNode::RN_SET:
+                start = add();
+                end   = add();
+
+                m_states[(size_t)start].set  = node->set;
+                m_states[(size_t)start].next = end;
+                break;
+            case RegexNode::RN_EMPTY:
+                start = add();
+                end   = add();
+                link(start, end);
+                break;
+            case RegexNode::RN_CAT:
+                build(node->children[0], start, end);
+                for (size_t i = 1; i < node->children.size(); ++i)
+                {
+                    build(node->children[i], cs, ce);
+                    link(end, cs);
+                    end = ce;
+                }
+                break;
+            case RegexNode::RN_ALT:
+                start = add();
+                end   = add();
+                for (const RegexNode* child : node->children)
+                {
+                    build(child, cs, ce);
+                    link(start, cs);
+                    link(ce, end);
+                }
+                break;
+            case RegexNode::RN_REPEAT:
+            {
+                const RegexNode* child = node->children[0];
+
+                start   = add();
+                end     = add();
+                int cur = start, i;
+
+                for (i = 0; i < node->min; ++i)
+                {
+                    build(child, cs, ce);
+                    link(cur, cs);
+                    cur = ce;
+                }
+
+                if (node->max < 0)
+                {
+                    const int loop = add();
+                    build(child, cs, ce);
+                    link(cur, loop);
+                    link(loop, cs);
+                    link(ce, loop);
+                    cur = loop;
+                }
+                else
+                {
+                    for (; i < node->max; ++i)
+                    {
+                        build(child, cs, ce);
+                        link(cur, end);
+                        link(cur, cs);
+                        cur = ce;
+                    }
+                }
+                link(cur, end);
+                break;
+            }
+            }
+        }
+
+        void closure(std::vector<int>& set, std::vector<char>& mark) const
+        {
+            std::vector<int> stack(set);
+            for (int s : set)
+                mark[(size_t)s] = 1;
+
+            while (!stack.empty())
+            {
+                const int s = stack.back();
+                stack.pop_back();
+
+                for (int e : m_states[(size_t)s].epsilon)
+                {
+                    if (!mark[(size_t)e])
+                    {
+                        mark[(size_t)e] = 1;
+                        set.push_back(e);
+                        stack.push_back(e);
+                    }
+                }
+            }
+
+            for (int s : set)
+                mark[(size_t)s] = 0;
+            std::sort(set.begin(), set.end());
+        }
+    };
+}  // namespace
+
+TokenDFA::TokenDFA() :
+    m_table(nullptr),
+    m_accept(nullptr),
+    m_classCount(0),
+    m_stateCount(0)
+{
+    skMemset(m_classes, 0, sizeof(m_classes));
+    skMemset(m_startable, 0, sizeof(m_startable));
+}
+
+TokenDFA::~TokenDFA()
+{
+    skArray<Pattern*>::Iterator it = m_patterns.iterator();
+    while (it.hasMoreElements())
+        delete it.getNext();
+
+    delete[] m_table;
+    delete[] m_accept;
+}
+
+void TokenDFA::addPattern(const char* name, const char* expression)
+{
+    Pattern* pattern    = new Pattern();
+    pattern->name       = name;
+    pattern->expression = expression;
+    m_patterns.push_back(pattern);
+}
+
+void TokenDFA::addDefaultPatterns()
+{
+    addPattern("url",
+               "[A-Za-z][A-Za-z0-9+.\\-]{1,15}://[A-Za-z0-9._~:/?#@!$&'()*+,;=%\\-]+");
+    addPattern("email",
+               "[A-Za-z0-9._%+\\-]{1,64}@([A-Za-z0-9\\-]+\\.)+[A-Za-z]{2,}");
+    addPattern("guid",
+               "\\{[0-9A-Fa-f]{8}-[0-9A-Fa-f]{4}-[0-9A-Fa-f]{4}-[0-9A-Fa-f]{4}-[0-9A-Fa-f]{12}\\}|"
+               "[0-9A-Fa-f]{8}-[0-9A-Fa-f]{4}-[0-9A-Fa-f]{4}-[0-9A-Fa-f]{4}-[0-9A-Fa-f]{12}");
+    addPattern("ipv6",
+               "([0-9A-Fa-f]{1,4}:){7}[0-9A-Fa-f]{1,4}|"
+               "([0-9A-Fa-f]{1,4}:){1,6}(:[0-9A-Fa-f]{1,4}){1,6}|"
+               "([0-9A-Fa-f]{1,4}:){1,7}:|"
+               "::([0-9A-Fa-f]{1,4}:){1,6}[0-9A-Fa-f]{1,4}|::1");
+    addPattern("ipv4",
+               "((25[0-5]|2[0-4][0-9]|1[0-9][0-9]|[1-9]?[0-9])\\.){3}"
+               "(25[0-5]|2[0-4][0-9]|1[0-9][0-9]|[1-9]?[0-9])");
+    addPattern("path",
+               "[A-Za-z]:\\\\([A-Za-z0-9_.$~ ()\\-]+\\\\)*[A-Za-z0-9_.$~()\\-]+|"
+               "(/[A-Za-z0-9_.~+@\\-]+){2,}/?");
+}
+
+bool TokenDFA::loadPatterns(const char* path)
+{
+    skFileStream fp;
+    fp.open(path, skStream::READ);
+    if (!fp.isOpen())
+    {
+        skLogf(LD_ERROR, "Failed to open file %s\n", path);
+        return false;
+    }
+
+    const SKsize size = fp.size();
+
+    char* text = new char[size + 1];
+    text[fp.read(text, size)] = 0;
+
+    char* line = text;
+    while (line && *line)
+    {
+        char* next = strchr(line, '\n');
+        if (next)
+            *next++ = 0;
+
+        SKsize len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' '))
+            line[--len] = 0;
+
+        while (*line == ' ' || *line == '\t')
+            ++line;
+
+        if (*line && *line != '#')
+        {
+            char* expr = line;
+            while (*expr && *expr != ' ' && *expr != '\t')
+                ++expr;
+
+            if (*expr)
+            {
+                *expr++ = 0;
+                while (*expr == ' ' || *expr == '\t')
+                    ++expr;
+            }
+
+            if (!*expr)
+            {
+                skLogf(LD_ERROR, "%s: pattern %s has no expression\n", path, line);
+                delete[] text;
+                return false;
+            }
+            addPattern(line, expr);
+        }
+        line = next;
+    }
+
+    delete[] text;
+    return true;
+}
+
+bool TokenDFA::compile()
+{
+    RegexParser parser;
+    NfaBuilder  nfa;
+
+    const int root = nfa.add();
+
+    std::vector<CharSet> sets;
+    for (SKuint32 i = 0; i < m_patterns.size(); ++i)
+    {
+        const char* expression = m_patterns[i]->expression.c_str();
+
+        const RegexNode* node = parser.parse(expression);
+        if (!node)
+        {
+            skLogf(LD_ERROR,
+                   "pattern %s: %s at offset %u\n",
+                   m_patterns[i]->name.c_str(),
+                   parser.getError(),
+                   (SKuint32)parser.getErrorOffset(expression));
+            return false;
+        }
+
+        int start, end;
+        nfa.build(node, start, end);
+        nfa.link(root, start);
+        nfa.m_states[(size_t)end].accept = (int)i;
+    }
+
+    // Bytes that no set tells apart share a class.
+    for (const NfaState& state : nfa.m_states)
+    {
+        if (state.next != -1)
+            sets.push_back(state.set);
+    }
+
+    std::map<std::vector<bool>, SKuint32> signatures;
+    SKuint8                               representative[256];
+
+    for (int b = 0; b < 256; ++b)
+    {
+        std::vector<bool> signature(sets.size());
+        for (size_t i = 0; i < sets.size(); ++i)
+            signature[i] = sets[i].test((size_t)b);
+
+        auto it = signatures.find(signature);
+        if (it == signatures.end())
+        {
+            const SKuint32 cls = (SKuint32)signatures.size();
+            signatures.insert(std::make_pair(signature, cls));
+            representative[cls] = (SKuint8)b;
+            m_classes[b]        = (SKuint8)cls;
+        }
+        else
+            m_classes[b] = (SKuint8)it->second;
+    }
+    m_classCount = (SKuint32)signatures.size();
+
+    // Subset construction
+    std::map<std::vector<int>, SKuint32> ids;
+    std::vector<std::vector<int>>        states;
+    std::vector<SKuint32>                table;
+    std::vector<SKint32>                 accept;
+    std::vector<char>                    mark(nfa.m_states.size(), 0);
+
+    states.emplace_back();
+    ids.insert(std::make_pair(states[0], DeadState));
+
+    std::vector<int> set(1, root);
+    nfa.closure(set, mark);
+    states.push_back(set);
+    ids.insert(std::make_pair(set, Start));
+
+    for (SKuint32 cur = 0; cur < states.size(); ++cur)
+    {
+        SKint32 acc = -1;
+        for (int s : states[cur])
+        {
+            const int a = nfa.m_states[(size_t)s].accept;
+            if (a != -1 && (acc == -1 || a < acc))
+                acc = a;
+        }
+        accept.push_back(acc);
+
+        for (SKuint32 cls = 0; cls < m_classCount; ++cls)
+        {
+            const SKuint8 b = representative[cls];
+
+            set.clear();
+            for (int s : states[cur])
+            {
+                const NfaState& state = nfa.m_states[(size_t)s];
+                if (state.next != -1 && state.set.test(b))
+                    set.push_back(state.next);
+            }
+            nfa.closure(set, mark);
+
+            SKuint32 id;
+
+            auto it = ids.find(set);
+            if (it == ids.end())
+            {
+                id = (SKuint32)states.size();
+                if (id >= MaxStates)
+                {
+                    skLogd(LD_ERROR, "the patterns are too complex to compile\n");
+                    return false;
+                }
+                ids.insert(std::make_pair(set, id));
+                states.push_back(set);
+            }
+            else
+                id = it->second;
+
+            table.push_back(id);
+        }
+    }
+
+    delete[] m_table;
+    delete[] m_accept;
+
+    m_stateCount = (SKuint32)states.size();
+    m_table      = new SKuint32[table.size()];
+    m_accept     = new SKint32[accept.size()];
+    memcpy(m_table, table.data(), sizeof(SKuint32) * table.size());
+    memcpy(m_accept, accept.data(), sizeof(SKint32) * accept.size());
+
+    for (int b = 0; b < 256; ++b)
+        m_startable[b] = m_table[Start * m_classCount + m_classes[b]] != DeadState;
+    return true;
+}
+
+void TokenDFA::scan(const SKuint8* data,
+                    SKsize         len,
+                    SKuint64       address,
+                    Visitor        visitor,
+                    void*          user) const
+{
+    // Pairs of position and state from which no accepting state can be
+    // reached (Reps, maximal munch tokenization in linear time). A run
+    // stops when it reaches one. Pairs are only kept at every MemoStride
+    // positions, which lets a run walk up to MemoStride bytes before it
+    // meets a known pair but keeps the table small, so a byte is walked
+    // at most about MemoStride times from each state. Tails shorter than
+    // that are not recorded at all.
+    // Buckets behind the start of the current run are never looked at
+    // again and are dropped as the scan moves forward.
+    const SKsize MemoStride = 16;
+
+    std::deque<std::vector<SKuint32> > failed;
+
+    SKsize failedBase = 0;
+
+    const auto isFailed = [&](SKsize pos, SKuint32 state) {
+        const SKsize b = pos / MemoStride;
+        if (b < failedBase || b - failedBase >= failed.size())
+            return false;
+        const std::vector<SKuint32>& v = failed[b - failedBase];
+        return std::find(v.begin(), v.end(), state) != v.end();
+    };
+
+    const auto setFailed = [&](SKsize pos, SKuint32 state) {
+        const SKsize b = pos / MemoStride;
+        if (failed.empty())
+            failedBase = b;
+        while (b - failedBase >= failed.size())
+            failed.emplace_back();
+        std::vector<SKuint32>& v = failed[b - failedBase];
+        if (std::find(v.begin(), v.end(), state) == v.end())
+            v.push_back(state);
+    };
+
+    SKsize i = 0, j, last, end;
+    while (i < len)
+    {
+        if (!m_startable[data[i]])
+        {
+            ++i;
+            continue;
+        }
+
+        while (!failed.empty() && failedBase * MemoStride <= i)
+        {
+            failed.pop_front();
+            ++failedBase;
+        }
+
+        SKuint32 state = Start, lastState = Start;
+        SKint32  token = -1;
+        last           = i;
+        end            = len;
+
+        for (j = i; j < len; ++j)
+        {
+            state = m_table[state * m_classCount + m_classes[data[j]]];
+            if (state == DeadState)
+            {
+                end = j;
+                break;
+            }
+
+            if (m_accept[state] != -1)
+            {
+                token     = m_accept[state];
+                last      = j + 1;
+                lastState = state;
+            }
+
+            if ((j + 1) % MemoStride == 0 && isFailed(j + 1, state))
+            {
+                end = j + 1;
+                break;
+            }
+        }
+
+        // Walk the tail past the last accept again to record it.
+        if (end - last > MemoStride)
+        {
+            state = lastState;
+            for (j = last; j < end; ++j)
+            {
+                state = m_table[state * m_classCount + m_classes[data[j]]];
+                if ((j + 1) % MemoStride == 0)
+                    setFailed(j + 1, state);
+            }
+        }
+
+        if (token != -1)
+        {
+            visitor(user, (SKuint32)token, address + i, data + i, last - i);
+            i = last;
+        }
+        else
+            ++i;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+-------------------------------------------------------------------------------
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+-------------------------------------------------------------------------------
+*/
+#ifndef _spTokenDFA_h_
+#define _spTokenDFA_h_
+
+#include "Utils/skString.h"
+
+// Deterministic automaton compiled from a set of regular expressions.
+// The input bytes are first reduced to equivalence classes, so the
+// transition table is states x classes rather than states x 256.
+//
+// Supported syntax: literals, ., [...], [^...], (...), |, *, +, ?, {m},
+// {m,}, {m,n} and the escapes \d \w \s \xHH plus any escaped literal.
+class TokenDFA
+{
+public:
+    // Receives the pattern index and the address range of each token.
+    typedef void (*Visitor)(void*          user,
+                            SKuint32       pattern,
+                            SKuint64       address,
+                            const SKuint8* token,
+                            SKsize         len);
+
+    struct Pattern
+    {
+        skString name;
+        skString expression;
+    };
+
+private:
+    skArray<Pattern*> m_patterns;
+    SKuint32*         m_table;
+    SKint32*          m_accept;
+    SKuint8           m_classes[256];
+    bool              m_startable[256];
+    SKuint32          m_classCount;
+    SKuint32          m_stateCount;
+
+public:
+    TokenDFA();
+    ~TokenDFA();
+
+    void addPattern(const char* name, const char* expression);
+
+    // Adds the built in url, email, guid, ipv4, ipv6 and path patterns.
+    void addDefaultPatterns();
+
+    // Loads one "name expression" pair per line, # starts a comment.
+    bool loadPatterns(const char* path);
+
+    bool compile();
+
+    // Emits the longest match at each position, with ties going to
+    // the pattern that was added first. Scanning resumes after a match.
+    // Failed runs are recorded every 16 bytes, so a byte is stepped at
+    // most about 16 times from each DFA state and the time stays linear
+    // in len however long the runs that fail to match are.
+    void scan(const SKuint8* data,
+              SKsize         len,
+              SKuint64       address,
+              Visitor        visitor,
+              void*          user) const;
+
+    SK_INLINE const char* getName(const SKuint32 pattern) const
+    {
+        return m_patterns[pattern]->name.c_str();
+    }
+
+    SK_INLINE SKuint32 getStateCount() const
+    {
+        return m_stateCount;
+    }
+};
+
+#endif  //_spTokenDFA_h_
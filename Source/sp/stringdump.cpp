@@ -17,11 +17,22 @@
   3. This notice may not be removed or altered from any source distribution.
 -------------------------------------------------------------------------------
 */
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include "Utils/CommandLine/skCommandLineParser.h"
 #include "Utils/skFileStream.h"
 #include "Utils/skHexPrint.h"
 #include "Utils/skLogger.h"
 #include "Utils/skString.h"
+#include "baseCodec.h"
+#include "mappedFile.h"
+#include "orderedPipeline.h"
+#include "outputBuffer.h"
+#include "spRunStatistics.h"
+#include "spStringTable.h"
+#include "spSuffixArray.h"
+#include "spTokenDFA.h"
 
 using namespace skHexPrint;
 using namespace skCommandLine;
@@ -38,6 +49,18 @@ enum SwitchIds
     SP_HEX,
     SP_BASE64,
     SP_RANGE,
+    SP_UNIQUE,
+    SP_BUDGET,
+    SP_INDEX,
+    SP_INDEX_STRINGS,
+    SP_QUERY,
+    SP_QUERY_HEX,
+    SP_SECRETS,
+    SP_ENTROPY,
+    SP_TOKENS,
+    SP_PATTERNS,
+    SP_DECODE,
+    SP_THREADS,
     SP_MAX
 };
 
@@ -129,22 +152,153 @@ const Switch Switches[SP_MAX] = {
         true,
         2,
     },
+    {
+        SP_UNIQUE,
+        0,
+        "unique",
+        "Print each distinct string once, sorted, along with\n"
+        "  its count and the first and last address it was found at.",
+        true,
+        0,
+    },
+    {
+        SP_BUDGET,
+        0,
+        "budget",
+        "Set the memory budget for --unique.\n"
+        "  - Arguments: megabytes [1-N] (default 256)\n"
+        "    - Sorted runs are spilled to temporary files past the budget.",
+        true,
+        1,
+    },
+    {
+        SP_INDEX,
+        0,
+        "index",
+        "Build a suffix array over the file or range and save it\n"
+        "  next to the file as <file>.sa",
+        true,
+        0,
+    },
+    {
+        SP_INDEX_STRINGS,
+        0,
+        "index-strings",
+        "Same as --index, but only the suffixes that start inside a\n"
+        "  string selected by the current filters are kept.",
+        true,
+        0,
+    },
+    {
+        SP_QUERY,
+        'q',
+        "query",
+        "Print the address of every occurrence of the text using <file>.sa\n"
+        "  - Arguments: text",
+        true,
+        1,
+    },
+    {
+        SP_QUERY_HEX,
+        0,
+        "query-hex",
+        "Print the address of every occurrence of a byte sequence using <file>.sa\n"
+        "  - Arguments: Base 16 byte sequence [00-FF]+",
+        true,
+        1,
+    },
+    {
+        SP_SECRETS,
+        's',
+        "secrets",
+        "Only print strings that look like keys, passwords or hashes.\n"
+        "  - Each string is printed after its entropy in bits per character.\n"
+        "  - The minimum string length defaults to 16.",
+        true,
+        0,
+    },
+    {
+        SP_ENTROPY,
+        'e',
+        "entropy",
+        "Set the minimum entropy in bits per character for --secrets.\n"
+        "  - Arguments: [0.0-8.0]\n"
+        "    - By default the threshold scales with the string length and alphabet.",
+        true,
+        1,
+    },
+    {
+        SP_TOKENS,
+        't',
+        "tokens",
+        "Print typed tokens along with their address.\n"
+        "  - Types: url, email, guid, ipv4, ipv6, path",
+        true,
+        0,
+    },
+    {
+        SP_PATTERNS,
+        'p',
+        "patterns",
+        "Add token types from a file, implies --tokens.\n"
+        "  - Arguments: file with one 'name expression' pair per line",
+        true,
+        1,
+    },
+    {
+        SP_DECODE,
+        0,
+        "decode",
+        "Decode the --base64 or --hex strings and search the result.\n"
+        "  - Arguments: depth [1-16]\n"
+        "    - The minimum encoded length defaults to 16.\n"
+        "    - Nested addresses are written as outer>inner.",
+        true,
+        1,
+    },
+    {
+        SP_THREADS,
+        0,
+        "threads",
+        "Scan the range on more than one thread.\n"
+        "  - Arguments: number of threads [0-256], 0 uses one per core\n"
+        "    - Only used when the strings are printed as they are found.",
+        true,
+        1,
+    },
 };
 
+const SKsize ChunkSize = 1 << 20;
+
+const SKsize MinNestedString = 4;
+
 class Application
 {
 private:
-    skFileStream m_stream;
-    SKuint32     m_addressRange[2];
-    SKuint32     m_number;
-    bool         m_upperCase;
-    bool         m_lowercaseCase;
-    bool         m_digit;
-    bool         m_hex;
-    bool         m_base64;
-    bool         m_logAddress;
-    bool         m_noWhiteSpace;
-    SKuint32     m_merge;
+    skFileStream  m_stream;
+    SKuint32      m_addressRange[2];
+    SKuint32      m_number;
+    bool          m_upperCase;
+    bool          m_lowercaseCase;
+    bool          m_digit;
+    bool          m_hex;
+    bool          m_base64;
+    bool          m_logAddress;
+    bool          m_noWhiteSpace;
+    SKuint32      m_merge;
+    StringTable*  m_table;
+    skString      m_path;
+    skString      m_query;
+    int           m_index;
+    bool          m_secrets;
+    double        m_entropy;
+    RunStatistics m_stats;
+    TokenDFA*     m_tokens;
+    SKint32       m_depth;
+    SKuint32      m_threads;
+    MappedFile    m_map;
+    SKsize        m_begin;
+    SKsize        m_end;
 
 public:
     Application() :
@@ -157,7 +311,16 @@ public:
         m_base64(),
         m_logAddress(false),
         m_noWhiteSpace(false),
-        m_merge(SK_NPOS32)
+        m_merge(SK_NPOS32),
+        m_table(nullptr),
+        m_index(0),
+        m_secrets(false),
+        m_entropy(-1),
+        m_tokens(nullptr),
+        m_depth(0),
+        m_threads(1),
+        m_begin(0),
+        m_end(0)
     {
         m_addressRange[0] = SK_NPOS32;
         m_addressRange[1] = SK_NPOS32;
@@ -165,6 +328,8 @@ public:
 
     ~Application()
     {
+        delete m_table;
+        delete m_tokens;
     }
 
     int parse(int argc, char **argv)
@@ -181,18 +346,79 @@ public:
         m_base64        = psr.isPresent(SP_BASE64);
         m_noWhiteSpace  = psr.isPresent(SP_NO_WHITE_SPACE);
 
-        if (!m_logAddress && psr.isPresent(SP_MERGE))
+        if (psr.isPresent(SP_UNIQUE))
+        {
+            const SKint32 budget = skMax<SKint32>(psr.getValueInt(SP_BUDGET, 0, 256), 1);
+            m_table              = new StringTable((SKsize)budget * 1024 * 1024);
+        }
+
+        if (psr.isPresent(SP_SECRETS))
+        {
+            m_secrets = true;
+            m_number  = 16;
+            if (psr.isPresent(SP_ENTROPY))
+                m_entropy = atof(psr.getValueString(SP_ENTROPY, 0).c_str());
+
+            // Tokens do not contain white space
+            if (!m_lowercaseCase && !m_upperCase && !m_digit)
+                m_noWhiteSpace = true;
+
+            RunStatistics::initialize();
+        }
+
+        if (psr.isPresent(SP_TOKENS) || psr.isPresent(SP_PATTERNS))
+        {
+            m_tokens = new TokenDFA();
+            if (psr.isPresent(SP_PATTERNS))
+            {
+                if (!m_tokens->loadPatterns(psr.getValueString(SP_PATTERNS, 0).c_str()))
+                    return 1;
+            }
+
+            m_tokens->addDefaultPatterns();
+            if (!m_tokens->compile())
+                return 1;
+        }
+
+        if (psr.isPresent(SP_DECODE))
+        {
+            m_depth  = skClamp<SKint32>(psr.getValueInt(SP_DECODE, 0, 1), 1, 16);
+            m_number = 16;
+            if (!m_hex)
+                m_base64 = true;
+        }
+
+        if (!m_logAddress && !m_table && !m_secrets && !m_depth && psr.isPresent(SP_MERGE))
             m_merge = psr.getValueInt(SP_MERGE, 0, 0);
 
         if (psr.isPresent(SP_LENGTH))
             m_number = psr.getValueInt(SP_LENGTH, 0, 0);
 
+        if (psr.isPresent(SP_INDEX))
+            m_index = SP_INDEX;
+        else if (psr.isPresent(SP_INDEX_STRINGS))
+            m_index = SP_INDEX_STRINGS;
+
+        if (psr.isPresent(SP_QUERY))
+            m_query = psr.getValueString(SP_QUERY, 0);
+        else if (psr.isPresent(SP_QUERY_HEX))
+        {
+            if (!parseHex(psr.getValueString(SP_QUERY_HEX, 0).c_str()))
+            {
+                skLogd(LD_ERROR, "invalid hex sequence\n");
+                return 1;
+            }
+        }
+
         if (psr.isPresent(SP_RANGE))
         {
             m_addressRange[0] = psr.getValueInt(SP_RANGE, 0, SK_NPOS32, 16);
             m_addressRange[1] = psr.getValueInt(SP_RANGE, 1, SK_NPOS32, 10);
         }
 
+        if (psr.isPresent(SP_THREADS))
+            m_threads = (SKuint32)skClamp(psr.getValueInt(SP_THREADS, 0, 1), 0, 256);
+
         using StringArray = Parser::StringArray;
         StringArray &args = psr.getArgList();
         if (args.empty())
@@ -201,12 +427,20 @@ public:
             return 1;
         }
 
+        m_path = args[0].c_str();
         m_stream.open(args[0].c_str(), skStream::READ);
         if (!m_stream.isOpen())
         {
             skLogf(LD_ERROR, "Failed to open file %s\n", args[0].c_str());
             return 1;
         }
+
+        // The pipeline scans chunks out of order, so it reads from a mapping,
+        // and falls back to reading in order when that fails. The other modes
+        // carry state from one string to the next.
+        if (m_threads != 1 && !m_table && !m_secrets && !m_tokens && m_depth == 0 &&
+            m_merge == SK_NPOS32 && m_index == 0 && m_query.empty())
+            m_map.open(args[0].c_str());
         return 0;
     }
 
@@ -241,8 +475,188 @@ public:
         return result;
     }
 
+    bool parseHex(const char* str)
+    {
+        int     nibbles = 0;
+        SKuint8 byte    = 0;
+        for (; *str; ++str)
+        {
+            const char ch = *str;
+            if (ch == ' ' || ch == ',')
+                continue;
+
+            int v;
+            if (ch >= '0' && ch <= '9')
+                v = ch - '0';
+            else if (ch >= 'a' && ch <= 'f')
+                v = ch - 'a' + 10;
+            else if (ch >= 'A' && ch <= 'F')
+                v = ch - 'A' + 10;
+            else
+                return false;
+
+            byte = (SKuint8)(byte << 4 | v);
+            if (++nibbles % 2 == 0)
+            {
+                m_query.append((char)byte);
+                byte = 0;
+            }
+        }
+        return nibbles > 0 && nibbles % 2 == 0;
+    }
+
+    int index()
+    {
+        MappedFile file;
+        if (!file.open(m_path.c_str()))
+        {
+            skLogf(LD_ERROR, "Failed to map file %s\n", m_path.c_str());
+            return 1;
+        }
+
+        SKsize n, a, r;
+        n = file.getSize();
+        a = skClamp<SKsize>(m_addressRange[0], 0, n);
+        r = skClamp<SKsize>(m_addressRange[1], 0, n);
+
+        if (m_addressRange[0] != SK_NPOS32)
+            r = skMin(r, n - a);
+        else
+        {
+            a = 0;
+            r = n;
+        }
+
+        SuffixArray sa;
+        if (!sa.build(file.getData(), n, a, r))
+            return 1;
+
+        if (m_index == SP_INDEX_STRINGS)
+        {
+            const SKuint32 minLen = m_number != SK_NPOS32 ? m_number : 1;
+
+            SKuint8* mask = new SKuint8[r / 8 + 1];
+            memset(mask, 0, r / 8 + 1);
+
+            const SKuint8* data = file.getData() + a;
+
+            SKsize i = 0, j;
+            while (i < r)
+            {
+                j = i;
+                while (j < r && filterChar((char)data[j]))
+                    ++j;
+
+                if (j - i >= minLen)
+                {
+                    for (; i < j; ++i)
+                        mask[i >> 3] |= (SKuint8)(1 << (i & 7));
+                }
+                i = j + 1;
+            }
+
+            sa.filter(mask, SuffixArray::SA_STRINGS);
+            delete[] mask;
+        }
+
+        skString path = m_path;
+        path.append(".sa");
+        if (!sa.save(path.c_str()))
+            return 1;
+
+        skLogf(LD_INFO, "Indexed %llu suffixes into %s\n", (unsigned long long)sa.size(), path.c_str());
+        return 0;
+    }
+
+    int query()
+    {
+        MappedFile file;
+        if (!file.open(m_path.c_str()))
+        {
+            skLogf(LD_ERROR, "Failed to map file %s\n", m_path.c_str());
+            return 1;
+        }
+
+        skString path = m_path;
+        path.append(".sa");
+
+        SuffixArray sa;
+        if (!sa.load(path.c_str()))
+            return 1;
+
+        if (sa.getFileSize() != file.getSize())
+        {
+            skLogf(LD_ERROR, "%s is out of date, rebuild it with --index\n", path.c_str());
+            return 1;
+        }
+
+        SKuint64       first;
+        const SKuint64 count = sa.find(file.getData(),
+                                       (const SKuint8*)m_query.c_str(),
+                                       (SKuint32)m_query.size(),
+                                       first);
+
+        SKuint64* found = new SKuint64[count + 1];
+        for (SKuint64 i = 0; i < count; ++i)
+            found[i] = sa.at(first + i);
+        std::sort(found, found + count);
+
+        for (SKuint64 i = 0; i < count; ++i)
+            printf("%08llX\n", (unsigned long long)found[i]);
+
+        delete[] found;
+        return 0;
+    }
+
+    static void printToken(void*          user,
+                           SKuint32       pattern,
+                           SKuint64       address,
+                           const SKuint8* token,
+                           SKsize         len)
+    {
+        const Application* app = (const Application*)user;
+        printf("%08llX  %-8s %.*s\n",
+               (unsigned long long)address,
+               app->m_tokens->getName(pattern),
+               (int)len,
+               (const char*)token);
+    }
+
+    int tokens()
+    {
+        MappedFile file;
+        if (!file.open(m_path.c_str()))
+        {
+            skLogf(LD_ERROR, "Failed to map file %s\n", m_path.c_str());
+            return 1;
+        }
+
+        SKsize n, a, r;
+        n = file.getSize();
+        a = skClamp<SKsize>(m_addressRange[0], 0, n);
+        r = skClamp<SKsize>(m_addressRange[1], 0, n);
+
+        if (m_addressRange[0] != SK_NPOS32)
+            r = skMin(r, n - a);
+        else
+        {
+            a = 0;
+            r = n;
+        }
+
+        m_tokens->scan(file.getData() + a, r, a, printToken, this);
+        return 0;
+    }
+
     int print()
     {
+        if (m_tokens)
+            return tokens();
+        if (m_index != 0)
+            return index();
+        if (!m_query.empty())
+            return query();
+
         SKuint8 buffer[1025];
 
         skString tmpStr;
@@ -257,14 +671,29 @@ public:
         if (m_addressRange[0] != SK_NPOS32)
             m_stream.seek(a, SEEK_SET);
         else
+        {
+            a = 0;
             r = n;
+        }
+
+        if (m_map.isOpen())
+        {
+            OutputBuffer out;
+            m_begin = a;
+            m_end   = skMin(a + r, n);
+
+            OrderedPipeline pipeline(m_threads, ChunkSize);
+            pipeline.run(m_begin, m_end, scanChunk, this, out);
+            out.write("\n", 1);
+            return 0;
+        }
 
         SKuint64 address = 0;
 
         SKsize br, tr = 0, i, m = 0;
         while (!m_stream.eof() && tr < r)
         {
-            br = m_stream.read(buffer, skMin<SKsize>(1024, r));
+            br = m_stream.read(buffer, skMin<SKsize>(1024, r - tr));
             if (br != SK_NPOS32 && br > 0)
             {
                 buffer[br] = 0;
@@ -277,6 +706,9 @@ public:
                             address = tr + i;
 
                         tmpStr.append(ch);
+                        if (m_secrets)
+                            m_stats.push((SKuint8)ch);
+
                         if (m_merge != SK_NPOS32 && m_merge > 0)
                         {
                             if (m++ % m_merge == (m_merge - 1))
@@ -295,13 +727,225 @@ public:
         if (!tmpStr.empty())
             printBuffer(tmpStr, address);
 
-        putchar('\n');
+        if (m_table)
+            m_table->finalize(printEntry, this);
+        else
+            putchar('\n');
         return 0;
     }
 
+    // Prints the strings that start in [offset, offset + len). A string
+    // that starts before the chunk belongs to the one before it, and a
+    // string that reaches past the end is followed to the end of the range.
+    static void scanChunk(void* user, SKsize offset, SKsize len, OutputBuffer& out)
+    {
+        Application*   app  = (Application*)user;
+        const SKuint8* data = app->m_map.getData();
+        const SKsize   stop = offset + len;
+
+        SKsize i = offset, start;
+        if (i > app->m_begin && app->filterChar((char)data[i - 1]))
+        {
+            while (i < stop && app->filterChar((char)data[i]))
+                ++i;
+        }
+
+        while (i < stop)
+        {
+            if (!app->filterChar((char)data[i]))
+            {
+                ++i;
+                continue;
+            }
+
+            start = i;
+            while (i < app->m_end && app->filterChar((char)data[i]))
+                ++i;
+
+            if (app->m_number == SK_NPOS32 || i - start >= app->m_number)
+            {
+                if (app->m_logAddress)
+                    out.print("%08X  ", (SKuint32)(start - app->m_begin));
+
+                out.write((const char*)data + start, i - start);
+                out.write("\n", 1);
+            }
+        }
+    }
+
+    static void printEntry(void*,
+                           const char* str,
+                           SKuint32    len,
+                           SKuint64    count,
+                           SKuint64    first,
+                           SKuint64    last)
+    {
+        printf("%8llu  %08llX  %08llX  %.*s\n",
+               (unsigned long long)count,
+               (unsigned long long)first,
+               (unsigned long long)last,
+               (int)len,
+               str);
+    }
+
+    bool isSecret() const
+    {
+        const SKuint32 classes = m_stats.getClasses();
+        if (m_entropy >= 0)
+            return m_stats.entropy() >= m_entropy;
+
+        if (classes & RunStatistics::CC_HEX)
+        {
+            // Hashes and keys in hex mix digits with letters
+            if (!(classes & RunStatistics::CC_DIGIT) || m_stats.getClassCount() < 2)
+                return false;
+            return m_stats.relativeEntropy() >= 0.8;
+        }
+
+        // Words and identifiers rarely mix more than two classes
+        // and repeat their characters too often.
+        if (m_stats.getClassCount() < 2)
+            return false;
+        return m_stats.relativeEntropy() >= 0.85;
+    }
+
+    void printHistogram(const SKuint8* data, SKsize len, const skString& path)
+    {
+        SKuint64 counts[256] = {};
+        for (SKsize i = 0; i < len; ++i)
+            counts[data[i]]++;
+
+        SKuint32 distinct = 0, top[3] = {256, 256, 256};
+        double   entropy  = 0;
+        for (SKuint32 i = 0; i < 256; ++i)
+        {
+            if (counts[i] == 0)
+                continue;
+
+            ++distinct;
+            const double p = double(counts[i]) / double(len);
+            entropy -= p * log2(p);
+
+            for (int j = 0; j < 3; ++j)
+            {
+                if (top[j] == 256 || counts[i] > counts[top[j]])
+                {
+                    for (int k = 2; k > j; --k)
+                        top[k] = top[k - 1];
+                    top[j] = i;
+                    break;
+                }
+            }
+        }
+
+        printf("%s  histogram %u distinct, %4.2f bits, top", path.c_str(), distinct, entropy);
+        for (SKuint32 i : top)
+        {
+            if (i < 256)
+                printf(" %02X:%llu", i, (unsigned long long)counts[i]);
+        }
+        putchar('\n');
+    }
+
+    // Decodes an encoded run, reports what it holds then
+    // recurses into any encoded runs found in the result.
+    void decodeRun(const char* str, SKsize len, const skString& path, SKint32 depth)
+    {
+        // Characters that do not complete a quantum are usually neighbouring
+        // text rather than part of the run. Padded runs are aligned on their
+        // end, otherwise the trailing characters are dropped.
+        if (m_hex)
+            len &= ~(SKsize)1;
+        else if (len > 0 && str[len - 1] == '=')
+        {
+            str += len % 4;
+            len -= len % 4;
+        }
+        else if (len % 4 == 1)
+            --len;
+
+        SKuint8* payload = new SKuint8[BaseCodec::decodedBase64Size(len) + 16];
+
+        const SKsize size = m_hex ? BaseCodec::decodeHex(str, len, payload)
+                                  : BaseCodec::decodeBase64(str, len, payload);
+        if (size == SK_NPOS || size == 0)
+        {
+            delete[] payload;
+            return;
+        }
+
+        printf("%s  %s %llu -> %llu bytes\n",
+               path.c_str(),
+               m_hex ? "hex" : "base64",
+               (unsigned long long)len,
+               (unsigned long long)size);
+        printHistogram(payload, size, path);
+
+        char   address[20];
+        SKsize i = 0, j, k, e;
+        while (i < size)
+        {
+            j = i;
+            while (j < size && payload[j] >= 32 && payload[j] < 127)
+                ++j;
+
+            if (j - i >= MinNestedString)
+            {
+                skSprintf(address, sizeof address, ">%08X", (SKuint32)i);
+
+                skString nested = path;
+                nested.append(address);
+                printf("%s  %.*s\n", nested.c_str(), (int)(j - i), (const char*)payload + i);
+
+                // encoded runs inside of the string
+                for (k = i; depth < m_depth && k < j; k = e + 1)
+                {
+                    e = k;
+                    while (e < j && filterChar((char)payload[e]))
+                        ++e;
+
+                    if (e - k >= m_number)
+                    {
+                        skSprintf(address, sizeof address, ">%08X", (SKuint32)k);
+
+                        nested = path;
+                        nested.append(address);
+                        decodeRun((const char*)payload + k, e - k, nested, depth + 1);
+                    }
+                }
+            }
+            i = j + 1;
+        }
+        delete[] payload;
+    }
+
     void printBuffer(skString &tmpStr, SKuint64 address)
     {
-        if (m_number != SK_NPOS32)
+        if (m_depth > 0)
+        {
+            if (tmpStr.size() >= m_number)
+            {
+                char path[20];
+                skSprintf(path, sizeof path, "%08X", (SKuint32)address);
+                decodeRun(tmpStr.c_str(), tmpStr.size(), path, 1);
+            }
+        }
+        else if (m_table)
+        {
+            if (m_number == SK_NPOS32 || tmpStr.size() >= m_number)
+                m_table->insert(tmpStr.c_str(), (SKuint32)tmpStr.size(), address);
+        }
+        else if (m_secrets)
+        {
+            if (tmpStr.size() >= m_number && isSecret())
+            {
+                if (m_logAddress)
+                    printf("%08X  ", (SKuint32)address);
+                printf("%4.2f  %s\n", m_stats.entropy(), tmpStr.c_str());
+            }
+            m_stats.reset();
+        }
+        else if (m_number != SK_NPOS32)
         {
             if (tmpStr.size() >= m_number)
             {